@@ -20,6 +20,9 @@
 __const_udelay用到了current_cpu_data.loops_per_jiffy，经过排查，暂未发现这个值在trap_init之前被赋值 */
 struct cpuinfo_x86 boot_cpu_data = {0, 0, 0, 0, -1, 1, 0, 0, -1};
 
+/* 记录set_in_cr4打开过的cr4位，刷新全局TLB时要先关掉PGE再恢复 */
+unsigned long mmu_cr4_features;
+
 /* 用于存储grub返回的multiboot_t结构体的地址，
 我懒得为这个变量单独写个c文件，就放在这里吧, 因为主要就是这个文件中的代码会用到
 在head.S中，我们已经从ebx中为这个变量放上了正确的地址 */
@@ -314,6 +317,7 @@ void __init setup_arch(char **cmdline_p)
     unsigned long max_low_pfn;  /* 记录32位系统下内存管理系统最少可管理内存，也是可直接映射内存区与的边界，一般为896m */
     int i;                      /* 循环变量 */
     unsigned long bootmap_size; /* 记录引导内存分配器的位图大小 */
+    identify_cpu(&boot_cpu_data); /* 识别cpu，后面的内存管理要用到它的缓存行大小与能力位 */
     setup_memory_region();      /* 建立内存区域映射 */
     /* _text由链接脚本提供。假设_text标签指代的地址是0x1000，最后start_code的赋值就是0x1000。其实无论变量也好，标签也好，都是指代了个地址，
     &就是得到这个符号（标签，变量）所指代的地址 */
@@ -428,7 +432,11 @@ initrd(Initial RAM Disk) 是一个在内核启动初期加载到 RAM 的临时
 
         size = last_pfn - curr_pfn; /* 得到要添加的ram区域的页面数量 */
         /* 将可用RAM内存区域注册到bootmem分配器中，也就是位图清0（位图在初始化时全部置1了），以供内核在早期阶段使用 */
+#ifdef CONFIG_NO_BOOTMEM
+        memblock_add(PFN_PHYS(curr_pfn), PFN_PHYS(size)); /* 没有位图，登记到memblock的可用内存表中 */
+#else
         free_bootmem(PFN_PHYS(curr_pfn), PFN_PHYS(size));
+#endif
     }
 
     /* 将内核映像与引导内存位图自身占用内存保留 */
@@ -491,6 +499,63 @@ initrd(Initial RAM Disk) 是一个在内核启动初期加载到 RAM 的临时
         request_resource(&ioport_resource, standard_io_resources + i);
 }
 
+/* 检查eflags中的某一位能否被改变，参数：
+flag：要检查的位
+返回：能改变返回非0 */
+static int __init flag_is_changeable_p(u32 flag)
+{
+    u32 f1, f2;
+
+    /* 把eflags翻转flag位之后写回，再读出来，与原来的值比较 */
+    asm("pushfl\n\t"
+        "pushfl\n\t"
+        "popl %0\n\t"
+        "movl %0,%1\n\t"
+        "xorl %2,%0\n\t"
+        "pushl %0\n\t"
+        "popfl\n\t"
+        "pushfl\n\t"
+        "popl %0\n\t"
+        "popfl\n\t"
+        : "=&r"(f1), "=&r"(f2)
+        : "ir"(flag));
+
+    return ((f1 ^ f2) & flag) != 0;
+}
+
+/* 用cpuid识别cpu，填写厂商、家族、型号、能力位与缓存行大小。
+Linux2.4中这个函数还要处理各个厂商的特殊情况与cpu的bug，我们只取内存管理需要的信息，参数：
+c：要填写的cpu信息 */
+void __init identify_cpu(struct cpuinfo_x86 *c)
+{
+    int junk, tfms, misc, capability;
+
+    c->cpuid_level = -1;
+    c->x86_cache_alignment = L1_CACHE_BYTES;
+    if (!flag_is_changeable_p(X86_EFLAGS_ID)) /* 386与早期的486没有cpuid指令 */
+        return;
+
+    /* 0号功能返回最高功能号与厂商字符串，字符串依次放在ebx、edx、ecx中 */
+    cpuid(0x00000000, &c->cpuid_level,
+          (int *)&c->x86_vendor_id[0],
+          (int *)&c->x86_vendor_id[8],
+          (int *)&c->x86_vendor_id[4]);
+    if (c->cpuid_level < 1)
+        return;
+
+    /* 1号功能：eax中是家族、型号、步进，edx中是能力位，ebx的8到15位是以8字节为单位的CLFLUSH缓存行大小 */
+    cpuid(0x00000001, &tfms, &misc, &junk, &capability);
+    c->x86 = (tfms >> 8) & 15;
+    c->x86_model = (tfms >> 4) & 15;
+    c->x86_mask = tfms & 15;
+    c->x86_capability[0] = capability;
+    if (cpu_has(c, X86_FEATURE_CLFLSH) && ((misc >> 8) & 0xff))
+        c->x86_cache_alignment = ((misc >> 8) & 0xff) * 8;
+
+    printk("CPU: %s family %d model %d stepping %d, %d-byte cache lines\n",
+           c->x86_vendor_id, c->x86, c->x86_model, c->x86_mask, c->x86_cache_alignment);
+}
+
 /* 用于表示每个cpu是否已经被初始化的位图 */
 static unsigned long cpu_initialized __initdata = 0;
 
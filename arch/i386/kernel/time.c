@@ -24,8 +24,82 @@ static void timer_interrupt(int irq, void *dev_id, struct pt_regs *regs)
 /* 时钟中断对应的中断动作 */
 static struct irqaction irq0 = {timer_interrupt, SA_INTERRUPT, 0, "timer", NULL, NULL};
 
-/* 注册时钟中断的中断动作 */
+/* cpu的主频，以kHz为单位，由calibrate_tsc校准得出，为0表示校准失败 */
+unsigned long cpu_khz;
+
+/* 用计数器2计时的脉冲数，相当于5个时钟滴答，也就是50ms */
+#define CALIBRATE_LATCH (5 * LATCH)
+
+/* CALIBRATE_LATCH对应的微秒数 */
+#define CALIBRATE_TIME (5 * 1000020 / HZ)
+
+/* 利用8254计数器2校准时间戳计数器：让计数器2从CALIBRATE_LATCH倒数到0（约50ms），
+统计这段时间内时间戳计数器走过的周期数。
+返回：每微秒周期数的倒数乘以2的32次方（也就是 2^32 * 微秒 / 周期数），失败返回0 */
+static unsigned long __init calibrate_tsc(void)
+{
+    /* 将计数器2的门控信号（0x61端口的位0）置高，关闭扬声器（位1） */
+    outb((inb(0x61) & ~0x02) | 0x01, 0x61);
+    outb(0xb0, 0x43);                   /* 二进制计数，模式0，先写低字节后写高字节，计数器2 */
+    outb(CALIBRATE_LATCH & 0xff, 0x42); /* 计数初值的低字节 */
+    outb(CALIBRATE_LATCH >> 8, 0x42);   /* 计数初值的高字节 */
+
+    {
+        unsigned long startlow, starthigh;
+        unsigned long endlow, endhigh;
+        unsigned long count;
+
+        rdtsc(startlow, starthigh);
+        count = 0;
+        do
+        {
+            count++;
+        } while ((inb(0x61) & 0x20) == 0); /* 0x61端口的位5是计数器2的输出，倒数到0时变为1 */
+        rdtsc(endlow, endhigh);
+
+        if (count <= 1) /* 计数器2根本没有在工作 */
+            goto bad_ctc;
+
+        /* 64位减法，得到经过的周期数 */
+        __asm__("subl %2,%0\n\t"
+                "sbbl %3,%1"
+                : "=a"(endlow), "=d"(endhigh)
+                : "g"(startlow), "g"(starthigh),
+                  "0"(endlow), "1"(endhigh));
+
+        if (endhigh) /* cpu太快了，周期数超过了32位 */
+            goto bad_ctc;
+
+        if (endlow <= CALIBRATE_TIME) /* cpu太慢了，不足1MHz */
+            goto bad_ctc;
+
+        /* 计算 2^32 * CALIBRATE_TIME / 周期数 */
+        __asm__("divl %2"
+                : "=a"(endlow), "=d"(endhigh)
+                : "r"(endlow), "0"(0), "1"(CALIBRATE_TIME));
+
+        return endlow;
+    }
+bad_ctc:
+    return 0;
+}
+
+/* 注册时钟中断的中断动作，并校准时间戳计数器得到cpu主频 */
 void __init time_init(void)
 {
+    unsigned long tsc_quotient;
+
     setup_irq(0, &irq0); /* 注册时钟中断的中断动作 */
+
+    tsc_quotient = calibrate_tsc();
+    if (tsc_quotient)
+    {
+        /* cpu_khz = 1000 * 2^32 / tsc_quotient */
+        unsigned long eax = 0, edx = 1000;
+        __asm__("divl %2"
+                : "=a"(cpu_khz), "=d"(edx)
+                : "r"(tsc_quotient),
+                  "0"(eax), "1"(edx));
+        printk("Detected %lu.%03lu MHz processor.\n", cpu_khz / 1000, cpu_khz % 1000);
+    }
 }
\ No newline at end of file
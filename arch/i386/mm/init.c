@@ -7,6 +7,7 @@
 #include <linux/smp.h>
 #include <linux/init.h>
 #include <linux/bootmem.h>
+#include <linux/slab.h>
 #include <asm-i386/processor.h>
 #include <asm-i386/system.h>
 #include <asm-i386/pgtable.h>
@@ -68,6 +69,8 @@ static void __init fixrange_init(unsigned long start, unsigned long end, pgd_t *
 
 /* 扩充由startup_32在第一阶段创建页目录表和页表（当时不知道内存有多大，所只为开始的8MB建立了映射，
 现在知道了，自然就可以扩充），内核地址空间将映射到线性映射的结束位置。
+cpu支持PSE时，线性映射区每4MB直接用一个页目录项映射成大页，不再为它分配页表：896MB的低端内存省下224个页表页，
+内核访问线性映射区也只占用少量的大页TLB表项；cpu还支持PGE时，这些大页标记为全局页，进程切换后仍留在TLB中。
 并且并且为一段用于固定映射虚拟地址初始化了页表，但没有映射到物理页 */
 static void __init pagetable_init(void)
 {
@@ -76,6 +79,7 @@ static void __init pagetable_init(void)
     int i, j, k;                                        /* 循环变量 */
     pmd_t *pmd;                                         /* 指向页中间目录表表项的指针 */
     pte_t *pte;                                         /* 指向页表表项的指针 */
+    unsigned long __pe;                                 /* 大页的页目录项 */
     end = (unsigned long)__va(max_low_pfn * PAGE_SIZE); /* 计算要扩展映射的边界 */
     pgd_base = swapper_pg_dir;                          /* 得到页目录表基址，swapper_pg_dir定义在head.S中 */
     /* 我们要将整个直接线性映射区映射到内核地址空间，自然要得到3G对应的页全局目标表表项索引 */
@@ -99,6 +103,20 @@ static void __init pagetable_init(void)
             if (end && (vaddr >= end))             /* end为0，或者如果已处理所有需要的地址，则退出循环 */
                 break;
 
+            if (cpu_has_pse) /* 支持4MB大页，页目录项直接映射这4MB，不需要页表 */
+            {
+                set_in_cr4(X86_CR4_PSE);
+                boot_cpu_data.wp_works_ok = 1;
+                __pe = _KERNPG_TABLE + _PAGE_PSE + __pa(vaddr);
+                if (cpu_has_pge) /* 内核的映射在所有进程中都一样，标记为全局页 */
+                {
+                    set_in_cr4(X86_CR4_PGE);
+                    __pe += _PAGE_GLOBAL;
+                }
+                set_pmd(pmd, __pmd(__pe));
+                continue;
+            }
+
             pte = (pte_t *)alloc_bootmem_low_pages(PAGE_SIZE); /* 为页表分配内存 */
             set_pmd(pmd, __pmd(_KERNPG_TABLE + __pa(pte)));    /* 设置页中间目录项 */
 
@@ -140,6 +158,11 @@ void __init paging_init(void)
 
     __flush_tlb_all();
 
+#ifdef CONFIG_NO_BOOTMEM
+    /* 整个低端内存都已经映射，memblock从此可以分配8MB以上的内存了，mem_map就要放在低端内存的顶部 */
+    memblock_set_current_limit(max_low_pfn << PAGE_SHIFT);
+#endif
+
     {
         unsigned long zones_size[MAX_NR_ZONES] = {0, 0, 0}; /* 存储每个内存区域的大小 */
         unsigned int max_dma, high, low;                    /* max_dma 用于存储 DMA 区域的最大地址，high 和 low 用于存储系统中可用的最高和最低物理页帧号 */
@@ -185,6 +208,31 @@ static inline int page_is_ram(unsigned long pagenr)
     return 0;
 }
 
+/* 打印系统内存的使用情况：页面总数、空闲页面数、保留页面数，以及每个zone的伙伴系统统计计数。
+Linux2.4中这个函数由SysRq-M（Alt+SysRq+M）调用，我们还没有键盘驱动，在启动末尾调用一次 */
+void show_mem(void)
+{
+    int i, total = 0, reserved = 0, shared = 0; /* 页面总数、保留页面数、共享页面数 */
+
+    printk("Mem-info:\n");
+    i = max_mapnr;
+    while (i-- > 0) /* 遍历所有页面 */
+    {
+        total++;
+        if (PageReserved(mem_map + i))
+            reserved++;
+        else if (atomic_read(&mem_map[i].count))
+            shared += atomic_read(&mem_map[i].count) - 1;
+    }
+    printk("%d pages of RAM\n", total);
+    printk("%d free pages\n", nr_free_pages());
+    printk("%d reserved pages\n", reserved);
+    printk("%d pages shared\n", shared);
+    show_zone_stats(); /* 打印每个zone的伙伴系统统计计数 */
+    show_buddyinfo();  /* 打印每个zone每个阶的空闲块数与外部碎片指数 */
+    show_slabinfo();   /* 打印每个slab缓存池的对象数、slab数与分配统计 */
+}
+
 /* 通过遍历用户空间的页目录表项，来清除低地址映射 */
 void __init zap_low_mappings(void)
 {
@@ -203,6 +251,7 @@ void __init mem_init(void)
 {
     int codesize, reservedpages, datasize, initsize;
     int tmp;
+    unsigned long initialised; /* 已经初始化了页描述符的页面数 */
 
     if (!mem_map)
         BUG(); /* 如果管理整个系统的物理内存页数组不存在，就报错 */
@@ -218,8 +267,14 @@ void __init mem_init(void)
     totalram_pages += free_all_bootmem();
 
     reservedpages = 0; /* 初始化被保留的页面计数 */
-    /* 遍历从0到max_low_pfn（低端内存的最大页面帧号）的所有页面 */
-    for (tmp = 0; tmp < max_low_pfn; tmp++)
+    initialised = max_low_pfn;
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+    /* 延迟初始化的页描述符还不能读，其中的保留页面由page_alloc_init_late统计 */
+    if (initialised > contig_page_data.first_deferred_pfn)
+        initialised = contig_page_data.first_deferred_pfn;
+#endif
+    /* 遍历从0到max_low_pfn（低端内存的最大页面帧号）的所有已经初始化的页面 */
+    for (tmp = 0; tmp < initialised; tmp++)
         /* 判断页面是不是属于ram，并且是保留 */
         if (page_is_ram(tmp) && PageReserved(mem_map + tmp))
             /* 进入if，说明是属于ram，并且是被保留的 */
@@ -14,6 +14,9 @@ typedef struct
 而赋值操作从这个意义上本就天然是原子操作 */
 #define atomic_set(v, i) (((v)->counter) = (i))
 
+/* 读取一个原子变量的值，读取对齐的int本就是原子操作 */
+#define atomic_read(v) ((v)->counter)
+
 /* 定义一个数据原子初始化方式，还是那句话，赋值本就是原子操作 */
 #define ATOMIC_INIT(i) \
     {                  \
@@ -31,6 +34,15 @@ static __inline__ void atomic_inc(atomic_t *v)
         : "m"(v->counter));
 }
 
+/* 原子的将一个数减1，原因同atomic_inc */
+static __inline__ void atomic_dec(atomic_t *v)
+{
+    __asm__ __volatile__(
+        LOCK "decl %0"
+        : "=m"(v->counter)
+        : "m"(v->counter));
+}
+
 /* 将一个数原子-1，并且测试-1后是不是0，如果是就返回1，不是返回0。
 sete：set if equal 等价 "set if zero"，意思是如果之前的指令产生的结果使零标志被设置为 1，
 则将目标寄存器或内存位置设置为 1；否则设置为 0 */
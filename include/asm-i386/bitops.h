@@ -127,4 +127,214 @@ static __inline__ int test_and_change_bit(int nr, volatile void *addr)
     return oldbit;
 }
 
+/* 找到x中为1的最高位，最低位算第1位，x为0返回0，参数：
+x：要查找的数
+bsrl（Bit Scan Reverse）从高位向低位找第一个为1的位，把它的位置（从0开始）放进目的寄存器，
+x为0时目的寄存器的值没有定义，所以先单独判断 */
+static __inline__ int fls(int x)
+{
+    int r;
+
+    if (!x)
+        return 0;
+    __asm__("bsrl %1,%0"
+            : "=r"(r)
+            : "rm"(x));
+    return r + 1;
+}
+
+/* 找到word中为1的最低位的位置（从0开始），word不能为0，参数：
+word：要查找的数
+bsfl（Bit Scan Forward）从低位向高位找第一个为1的位 */
+static __inline__ unsigned long __ffs(unsigned long word)
+{
+    __asm__("bsfl %1,%0"
+            : "=r"(word)
+            : "rm"(word));
+    return word;
+}
+
+/* 找到word中为0的最低位的位置（从0开始），word不能全为1，参数：
+word：要查找的数 */
+static __inline__ unsigned long ffz(unsigned long word)
+{
+    __asm__("bsfl %1,%0"
+            : "=r"(word)
+            : "r"(~word));
+    return word;
+}
+
+/* 在位图中从第offset位开始找第一个为0的位，一次检查一个long，全为1的long整体跳过。
+Linux2.4中用repe scasl实现，这里用C按long遍历，参数：
+addr：位图的起始地址
+size：位图的位数
+offset：开始查找的位
+返回：找到的位，没有为0的位时返回size */
+static __inline__ unsigned long find_next_zero_bit(const void *addr, unsigned long size, unsigned long offset)
+{
+    const unsigned long *p = (const unsigned long *)addr + (offset >> 5);
+    unsigned long result = offset & ~31UL;
+    unsigned long tmp;
+
+    if (offset >= size)
+        return size;
+    size -= result;
+    offset &= 31UL;
+    if (offset) /* 第一个long中offset之前的位当作1 */
+    {
+        tmp = *(p++);
+        tmp |= ~0UL >> (32 - offset);
+        if (size < 32)
+            goto found_first;
+        if (~tmp)
+            goto found_middle;
+        size -= 32;
+        result += 32;
+    }
+    while (size & ~31UL)
+    {
+        if (~(tmp = *(p++)))
+            goto found_middle;
+        result += 32;
+        size -= 32;
+    }
+    if (!size)
+        return result;
+    tmp = *p;
+
+found_first:
+    tmp |= ~0UL << size; /* 最后一个long中超出size的位当作1 */
+    if (tmp == ~0UL)
+        return result + size;
+found_middle:
+    return result + ffz(tmp);
+}
+
+/* 在位图中从第offset位开始找第一个为1的位，一次检查一个long，全为0的long整体跳过，参数：
+addr：位图的起始地址
+size：位图的位数
+offset：开始查找的位
+返回：找到的位，没有为1的位时返回size */
+static __inline__ unsigned long find_next_bit(const void *addr, unsigned long size, unsigned long offset)
+{
+    const unsigned long *p = (const unsigned long *)addr + (offset >> 5);
+    unsigned long result = offset & ~31UL;
+    unsigned long tmp;
+
+    if (offset >= size)
+        return size;
+    size -= result;
+    offset &= 31UL;
+    if (offset) /* 第一个long中offset之前的位当作0 */
+    {
+        tmp = *(p++);
+        tmp &= ~0UL << offset;
+        if (size < 32)
+            goto found_first;
+        if (tmp)
+            goto found_middle;
+        size -= 32;
+        result += 32;
+    }
+    while (size & ~31UL)
+    {
+        if ((tmp = *(p++)))
+            goto found_middle;
+        result += 32;
+        size -= 32;
+    }
+    if (!size)
+        return result;
+    tmp = *p;
+
+found_first:
+    tmp &= ~0UL >> (32 - size); /* 最后一个long中超出size的位当作0 */
+    if (!tmp)
+        return result + size;
+found_middle:
+    return result + __ffs(tmp);
+}
+
+/* 把从p开始的n个long都写成val，用rep stosl一次写完，n为0时什么也不写 */
+static __inline__ void __bitmap_fill_words(unsigned long *p, unsigned long val, unsigned long n)
+{
+    int d0, d1;
+
+    __asm__ __volatile__("cld\n\t"
+                         "rep\n\t"
+                         "stosl"
+                         : "=&c"(d0), "=&D"(d1)
+                         : "a"(val), "0"(n), "1"(p)
+                         : "memory");
+}
+
+/* 把位图中从第start位开始的nr位置1。与set_bit不同，它不是原子操作，只能在没有并发的地方使用（比如引导期间），
+首尾不满一个long的部分用掩码处理，中间整个的long用rep stosl填满。参数：
+addr：位图的起始地址
+start：第一位
+nr：位数
+返回：这些位中原来就有为1的返回1，否则返回0，通过比较整个long得到，不用逐位测试 */
+static __inline__ int bitmap_set(void *addr, unsigned long start, unsigned long nr)
+{
+    unsigned long *p = (unsigned long *)addr + (start >> 5);
+    unsigned long last = start + nr - 1; /* 最后一位 */
+    unsigned long mask, seen, words, i;
+
+    if (!nr)
+        return 0;
+    mask = ~0UL << (start & 31UL);
+    if ((start >> 5) == (last >> 5)) /* 都在同一个long中 */
+    {
+        mask &= ~0UL >> (31UL - (last & 31UL));
+        seen = *p & mask;
+        *p |= mask;
+        return seen != 0;
+    }
+    seen = *p & mask;
+    *(p++) |= mask;
+    words = (last >> 5) - (start >> 5) - 1; /* 中间整个的long数 */
+    for (i = 0; i < words; i++)
+        seen |= p[i];
+    __bitmap_fill_words(p, ~0UL, words);
+    p += words;
+    mask = ~0UL >> (31UL - (last & 31UL));
+    seen |= *p & mask;
+    *p |= mask;
+    return seen != 0;
+}
+
+/* 把位图中从第start位开始的nr位清0，非原子操作，做法同bitmap_set。参数：
+addr：位图的起始地址
+start：第一位
+nr：位数
+返回：这些位中原来就有为0的返回1，否则返回0 */
+static __inline__ int bitmap_clear(void *addr, unsigned long start, unsigned long nr)
+{
+    unsigned long *p = (unsigned long *)addr + (start >> 5);
+    unsigned long last = start + nr - 1;
+    unsigned long mask, seen, words, i;
+
+    if (!nr)
+        return 0;
+    mask = ~0UL << (start & 31UL);
+    if ((start >> 5) == (last >> 5))
+    {
+        mask &= ~0UL >> (31UL - (last & 31UL));
+        seen = ~*p & mask;
+        *p &= ~mask;
+        return seen != 0;
+    }
+    seen = ~*p & mask;
+    *(p++) &= ~mask;
+    words = (last >> 5) - (start >> 5) - 1;
+    for (i = 0; i < words; i++)
+        seen |= ~p[i];
+    __bitmap_fill_words(p, 0UL, words);
+    p += words;
+    mask = ~0UL >> (31UL - (last & 31UL));
+    seen |= ~*p & mask;
+    *p &= ~mask;
+    return seen != 0;
+}
+
 #endif /* _ASM_I386_BITOPS_H */
\ No newline at end of file
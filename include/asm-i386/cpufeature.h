@@ -5,4 +5,24 @@
 N 表示 "Number"，而 CAPINTS 则是 "Capability Integers"（能力整数）的缩写 */
 #define NCAPINTS 4
 
+/* x86_capability中的能力位，第几个整数乘32加上位号，第0个整数是cpuid 1号功能返回的edx */
+
+/* 页大小扩展，页目录项可以直接映射一个4MB的页面（cr4的PSE位打开后生效） */
+#define X86_FEATURE_PSE (0 * 32 + 3)
+
+/* 全局页，带有_PAGE_GLOBAL的页表项在重新加载cr3时不会从TLB中清除（cr4的PGE位打开后生效） */
+#define X86_FEATURE_PGE (0 * 32 + 13)
+
+/* CLFLUSH指令，支持它的cpu在cpuid 1号功能的ebx中报告缓存行大小 */
+#define X86_FEATURE_CLFLSH (0 * 32 + 19)
+
+/* 检查cpu是否有某种能力 */
+#define cpu_has(c, bit) ((c)->x86_capability[(bit) >> 5] & (1UL << ((bit) & 31)))
+
+/* 启动cpu是否支持4MB大页 */
+#define cpu_has_pse cpu_has(&boot_cpu_data, X86_FEATURE_PSE)
+
+/* 启动cpu是否支持全局页 */
+#define cpu_has_pge cpu_has(&boot_cpu_data, X86_FEATURE_PGE)
+
 #endif /* _ASM_I386_CPUFEATURE_H */
\ No newline at end of file
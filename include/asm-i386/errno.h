@@ -1,7 +1,13 @@
 #ifndef _ASM_I386_ERRNO_H
 #define _ASM_I386_ERRNO_H
 
+/* 返回错误码，表示内存不足 */
+#define ENOMEM 12
+
 /* 返回错误吗，表示设备或资源被占用（忙） */
 #define EBUSY 16
 
+/* 返回错误码，表示参数无效 */
+#define EINVAL 22
+
 #endif /* _ASM_I386_ERRNO_H */
\ No newline at end of file
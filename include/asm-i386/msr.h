@@ -0,0 +1,18 @@
+#ifndef _ASM_I386_MSR_H
+#define _ASM_I386_MSR_H
+/* 访问cpu的型号专用寄存器（Model Specific Register），这里只复现了读取时间戳计数器（TSC）的部分 */
+
+/* 读取时间戳计数器，低32位放入low，高32位放入high。
+rdtsc指令将cpu上电以来经过的时钟周期数放入edx:eax */
+#define rdtsc(low, high) \
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high))
+
+/* 读取时间戳计数器的低32位 */
+#define rdtscl(low) \
+    __asm__ __volatile__("rdtsc" : "=a"(low) : : "edx")
+
+/* 读取完整的64位时间戳计数器，"=A"约束表示64位的值由edx:eax组成 */
+#define rdtscll(val) \
+    __asm__ __volatile__("rdtsc" : "=A"(val))
+
+#endif /* _ASM_I386_MSR_H */
@@ -109,7 +109,7 @@ Point p = (Point) { .x = 10, .y = 20 };
 #define PAGE_MASK (~(PAGE_SIZE - 1))
 
 /* 判断一个页面是否非法，就是判断页面是不是落在了mem_map数组范围内 */
-#define VALID_PAGE(page) ((page - mem_map) < max_mapnr)
+#define VALID_PAGE(page) ((unsigned long)((page) - mem_map) < max_mapnr)
 
 /* 将内核虚拟地址转换成对应的page地址 */
 #define virt_to_page(kaddr) (mem_map + (__pa(kaddr) >> PAGE_SHIFT))
@@ -117,5 +117,9 @@ Point p = (Point) { .x = 10, .y = 20 };
 /* arch/i386/kernel/head.S */
 extern unsigned long empty_zero_page[1024];
 
+/* 将一个页面清零，这句位于#ifdef CONFIG_X86_USE_3DNOW 的 #else 下，
+我们不使用3DNOW指令优化，直接用memset完成 */
+#define clear_page(page) memset((void *)(page), 0, PAGE_SIZE)
+
 #endif /* __ASSEMBLY__ */
 #endif /* _ASM_I386_PAGE_H */
\ No newline at end of file
@@ -77,6 +77,13 @@ extern void paging_init(void);
 /*  表示该页被写过（Dirty）。这个位用于页面写回操作，帮助确定哪些页面需要被写回到磁盘 */
 #define _PAGE_DIRTY 0x040
 
+/* 页目录项中的这一位表示它直接映射一个4MB的页面，而不是指向一张页表，需要cpu支持PSE并打开cr4的PSE位 */
+#define _PAGE_PSE 0x080
+
+/* 全局页，TLB中这样的表项在重新加载cr3时不会被清除，需要cpu支持PGE并打开cr4的PGE位。
+内核地址空间在所有进程中都一样，给它的表项设上这一位，进程切换之后不用重新查内核的页表 */
+#define _PAGE_GLOBAL 0x100
+
 /* 内核使用的页全局目录表表项属性位设定，存在，可读可写，已经被访问过，已经写过 */
 #define _KERNPG_TABLE (_PAGE_PRESENT | _PAGE_RW | _PAGE_ACCESSED | _PAGE_DIRTY)
 
@@ -86,18 +93,19 @@ extern void paging_init(void);
 /* 传入页表表项要填入的物理地址，与页表属性位。然后将其做成一个页表表现的内容 */
 #define mk_pte_phys(physpage, pgprot) __mk_pte((physpage) >> PAGE_SHIFT, pgprot)
 
-/* 原来MAKE_GLOBAL： if (cpu_has_pge) __ret = __pgprot((x) | _PAGE_GLOBAL); else __ret = __pgprot(x);
-由于不支持cpu_has_pge判断，所以直接改成了__ret = __pgprot(x);这么一句
-这个宏是依据cpu_has_pge来设定页全局使能（Page Global Enable, PGE）"
+/* 这个宏是依据cpu_has_pge来设定页全局使能（Page Global Enable, PGE）"
 通常，每当处理器的任务或上下文切换时，CPU的内存管理单元（MMU）需要刷新（重载）页表缓存，
 这称为 TLB（Translation Lookaside Buffer）刷新。PGE 特性允许某些页表项被标记为“全局”的，
 这意味着这些页表项在任务切换时不会从 TLB 中被清除。
 如果支持pge，对系统内核所在虚拟地址空间的页表表项设置 PGE（页全局使能）是非常有益的*/
-#define MAKE_GLOBAL(x)       \
-    ({                       \
-        pgprot_t __ret;      \
-        __ret = __pgprot(x); \
-        __ret;               \
+#define MAKE_GLOBAL(x)                             \
+    ({                                             \
+        pgprot_t __ret;                            \
+        if (cpu_has_pge)                           \
+            __ret = __pgprot((x) | _PAGE_GLOBAL);  \
+        else                                       \
+            __ret = __pgprot(x);                   \
+        __ret;                                     \
     })
 
 /* 设定内核使用的页表表项属性位，通用设定 + 是否支持全局是能 */
@@ -118,17 +126,34 @@ PGE没有被设置时，即使是标记为全局的页表项也会在 TLB 刷新
             : "=r"(tmpreg)::"memory");        \
     } while (0)
 
-/* 这个属于#ifdef CONFIG_X86_PGE的 #else 下的 if(cpu_has_pge) 的else，
-#else与if(cpu_has_pge)都是调用了__flush_tlb_global。__flush_tlb只刷新当前cpu的tlb，
-而__flush_tlb_global是刷新所有cpu的tlb。*/
-#define __flush_tlb_all() \
-    do                    \
-    {                     \
-        __flush_tlb();    \
+/* 连全局页一起刷新TLB：先关掉cr4的PGE位（这会清除TLB中所有的表项），重新加载cr3，再恢复cr4 */
+#define __flush_tlb_global()                                            \
+    do                                                                  \
+    {                                                                   \
+        unsigned int tmpreg;                                            \
+                                                                        \
+        __asm__ __volatile__(                                           \
+            "movl %1, %%cr4;  # turn off PGE     \n"                    \
+            "movl %%cr3, %0;  # flush TLB        \n"                    \
+            "movl %0, %%cr3;                     \n"                    \
+            "movl %2, %%cr4;  # turn PGE back on \n"                    \
+            : "=&r"(tmpreg)                                             \
+            : "r"(mmu_cr4_features & ~X86_CR4_PGE), "r"(mmu_cr4_features) \
+            : "memory");                                                \
+    } while (0)
+
+/* 刷新当前cpu的全部TLB。内核的页表项带有全局位时，只重新加载cr3清除不掉它们，要用__flush_tlb_global */
+#define __flush_tlb_all()         \
+    do                            \
+    {                             \
+        if (cpu_has_pge)          \
+            __flush_tlb_global(); \
+        else                      \
+            __flush_tlb();        \
     } while (0)
 
 /* 定义了用户空间的pgd数量 */
 #define USER_PTRS_PER_PGD (TASK_SIZE / PGDIR_SIZE)
 
 #endif /* __ASSEMBLY__ */
-#endif /* _ASM_I386_PAGETABLE_H */
\ No newline at end of file
+#endif /* _ASM_I386_PAGETABLE_H */
\ No newline at end of file
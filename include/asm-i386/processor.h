@@ -139,6 +139,9 @@ struct cpuinfo_x86
     char x86_vendor_id[16];         /*  CPU厂商ID。这是一个字符串，包含了CPU厂商的名称或标识 */
     char x86_model_id[64];          /*  CPU型号ID。这是一个更详细的CPU型号和名称的字符串 */
     int x86_cache_size;             /* 缓存大小（以KB为单位）。这表明了CPU的缓存大小，只对支持此功能的CPU有效 */
+    /* 缓存行大小（字节），由identify_cpu从cpuid检测，检测不到时是编译时的L1_CACHE_BYTES。
+    Linux2.4中没有这个字段，2.6中才有 */
+    int x86_cache_alignment;
     int fdiv_bug;                   /* FDIV错误。这个标志用于指示CPU是否受到著名的FDIV错误（浮点除法错误）的影响，主要在某些旧的Intel处理器中出现 */
     int f00f_bug;                   /* F00F错误。这是另一个历史上的CPU错误，影响了某些Intel处理器 */
     int coma_bug;                   /*  COMA错误。这是一个较少见的处理器错误，与CPU的特定行为有关 */
@@ -156,6 +159,49 @@ struct cpuinfo_x86
 /* arch/i386/kernel/setup.c */
 extern struct cpuinfo_x86 boot_cpu_data;
 
+/* arch/i386/kernel/setup.c */
+extern void identify_cpu(struct cpuinfo_x86 *c);
+
+/* 运行时检测到的缓存行大小，在identify_cpu之后才有意义 */
+#define cache_line_size() (boot_cpu_data.x86_cache_alignment)
+
+/* eflags中的ID位，能改变它的cpu才有cpuid指令 */
+#define X86_EFLAGS_ID 0x00200000
+
+/* 执行cpuid指令，参数：
+op：功能号
+eax、ebx、ecx、edx：存放返回的四个寄存器的值 */
+static inline void cpuid(int op, int *eax, int *ebx, int *ecx, int *edx)
+{
+    __asm__("cpuid"
+            : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+            : "0"(op));
+}
+
+/* cr4中的位 */
+
+/* 页大小扩展，打开后页目录项中设置了_PAGE_PSE的表项直接映射4MB的页面 */
+#define X86_CR4_PSE 0x0010
+
+/* 全局页使能，打开后设置了_PAGE_GLOBAL的页表项在重新加载cr3时不会从TLB中清除 */
+#define X86_CR4_PGE 0x0080
+
+/* arch/i386/kernel/setup.c */
+extern unsigned long mmu_cr4_features;
+
+/* 打开cr4中的mask位，并记入mmu_cr4_features，刷新全局TLB时要用它恢复cr4，参数：
+mask：要打开的位 */
+static inline void set_in_cr4(unsigned long mask)
+{
+    mmu_cr4_features |= mask;
+    __asm__("movl %%cr4,%%eax\n\t"
+            "orl %0,%%eax\n\t"
+            "movl %%eax,%%cr4\n"
+            :
+            : "irg"(mask)
+            : "ax");
+}
+
 /* 定义了初始化时系统用的task_struct */
 #define init_task (init_task_union.task)
 
@@ -31,4 +31,32 @@ static inline void init_MUTEX(struct semaphore *sem)
     sema_init(sem, 1); /* 将信号量初始化为1，等同于互斥锁 */
 }
 
+/* 获取信号量，参数：
+sem：要获取的信号量
+Linux2.4中信号量计数减1后为负会调用__down让当前任务睡眠在sem->wait上。
+我们还没有进程调度，内核只有start_kernel这一条执行流，信号量不会被别人持有，只做计数 */
+static inline void down(struct semaphore *sem)
+{
+    atomic_dec(&sem->count);
+}
+
+/* 尝试获取信号量，不会睡眠，参数：
+sem：要获取的信号量
+返回：获取到了返回0，信号量已经被持有返回1 */
+static inline int down_trylock(struct semaphore *sem)
+{
+    if (atomic_read(&sem->count) <= 0)
+        return 1;
+    atomic_dec(&sem->count);
+    return 0;
+}
+
+/* 释放信号量，参数：
+sem：要释放的信号量
+Linux2.4中计数加1后仍不为正会调用__up唤醒等待者，原因同down，我们只做计数 */
+static inline void up(struct semaphore *sem)
+{
+    atomic_inc(&sem->count);
+}
+
 #endif /* _ASM_I386_SEMAPHORE_H */
\ No newline at end of file
@@ -2,8 +2,25 @@
 #define _ASM_I386_TIMEX_H
 /* 通常包含了与时间和计时相关的定义和结构，名字timex由来：时间”（time）相关的扩展（extensions） */
 
+#include <asm-i386/msr.h>
+
 /* 计数器0的工作脉冲信号频率 */
 #define CLOCK_TICK_RATE	1193180
 
+/* 时钟周期数的类型 */
+typedef unsigned long long cycles_t;
+
+/* 读取当前的时钟周期数，位于#ifdef CONFIG_X86_TSC下，我们默认cpu支持rdtsc指令 */
+static inline cycles_t get_cycles(void)
+{
+    unsigned long long ret;
+
+    rdtscll(ret);
+    return ret;
+}
+
+/* arch/i386/kernel/time.c */
+extern unsigned long cpu_khz;
+
 #endif /* _ASM_I386_TIMEX_H */
 
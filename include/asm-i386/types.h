@@ -28,4 +28,7 @@ typedef unsigned int u32;
 typedef signed long long s64;
 typedef unsigned long long u64;
 
+/* 一个long类型的位数，位于#ifdef __KERNEL__下 */
+#define BITS_PER_LONG 32
+
 #endif /* _ASM_I386_TYPES_H */
\ No newline at end of file
@@ -7,6 +7,15 @@
 #include <linux/init.h>
 #include <linux/mmzone.h>
 
+/* 打开后引导内存分配器不再用每页一位的位图记录内存，改用按区间记录的memblock（见linux/memblock.h）：
+分配从高地址往低地址找，代价只与区间数有关；交给伙伴系统时直接按空闲区间整段释放，不再扫描位图。
+名字沿用Linux，意思是没有bootmem的位图，分配接口不变。默认关闭 */
+// #define CONFIG_NO_BOOTMEM
+
+#ifdef CONFIG_NO_BOOTMEM
+#include <linux/memblock.h>
+#endif
+
 extern void __init reserve_bootmem(unsigned long addr, unsigned long size);
 extern unsigned long __init init_bootmem(unsigned long addr, unsigned long memend);
 extern void __init free_bootmem(unsigned long addr, unsigned long size);
@@ -34,6 +43,10 @@ typedef struct bootmem_data
     unsigned long last_pos;    /* 最后一次成功的内存分配在内存页中的位置（页帧号） */
 } bootmem_data_t;
 
+/* mm/bootmem.c */
+extern unsigned long __init bootmem_find_free(unsigned long *map, unsigned long eidx, unsigned long preferred,
+                                              unsigned long areasize, unsigned long incr);
+
 /* mm/bootmem.c */
 extern void *__init __alloc_bootmem(unsigned long size, unsigned long align, unsigned long goal);
 
@@ -67,4 +67,26 @@ static __inline__ void list_add(struct list_head *new, struct list_head *head)
     __list_add(new, head, head->next);
 }
 
+/* 把一个节点加到双链表的尾部，也就是链表头的前面，参数：
+new：要加入的链表节点
+head：链表头 */
+static __inline__ void list_add_tail(struct list_head *new, struct list_head *head)
+{
+    __list_add(new, head->prev, head);
+}
+
+/* 判断一个双链表是否为空，就是链表头的next是否指向自己，参数：
+head：要判断的链表头 */
+static __inline__ int list_empty(struct list_head *head)
+{
+    return head->next == head;
+}
+
+/* 通过结构体中链表节点的地址，得到该结构体本身的地址，参数：
+ptr：结构体中链表节点的地址
+type：结构体的类型
+member：链表节点在结构体中的成员名 */
+#define list_entry(ptr, type, member) \
+    ((type *)((char *)(ptr) - (unsigned long)(&((type *)0)->member)))
+
 #endif /* _LINUX_LIST_H */
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef _LINUX_MEMBLOCK_H
+#define _LINUX_MEMBLOCK_H
+/* 按区间管理的引导内存分配器（memblock），Linux2.6.35起x86用它取代了bootmem的位图。
+它只记两张按地址排好序、互不重叠的区间表：memory是e820报告的可用内存，reserved是已经被占用的内存，
+空闲内存就是memory减去reserved。分配时从高地址往低地址找第一段放得下的空闲区间，
+代价只与区间数有关，与内存大小无关；交给伙伴系统时直接按空闲区间整段释放，不用扫描位图。
+只在CONFIG_NO_BOOTMEM（见linux/bootmem.h）打开时编译 */
+
+#include <linux/init.h>
+
+/* memory与reserved两张区间表各自的最大项数，表是静态分配的，因为它们在任何分配器可用之前就要使用 */
+#define INIT_MEMBLOCK_REGIONS 128
+
+/* head.S只映射了物理内存的前8MB，pagetable_init建立完整的线性映射之前，分配出去的内存都必须在这之内 */
+#define MEMBLOCK_INITIAL_LIMIT (8UL << 20)
+
+/* 一段物理内存区间[base, base + size) */
+struct memblock_region
+{
+    unsigned long base; /* 起始物理地址 */
+    unsigned long size; /* 字节数 */
+};
+
+/* 一张区间表，区间按base从小到大排列，互不重叠，相邻的区间已经合并 */
+struct memblock_type
+{
+    unsigned long cnt;                                      /* 区间数 */
+    struct memblock_region regions[INIT_MEMBLOCK_REGIONS]; /* 区间 */
+};
+
+struct memblock
+{
+    unsigned long current_limit;   /* 分配出去的内存的最高地址（不含），只能分配已经映射的内存 */
+    struct memblock_type memory;   /* 可用内存 */
+    struct memblock_type reserved; /* 已经被占用的内存 */
+};
+
+/* mm/memblock.c */
+extern struct memblock memblock;
+
+/* mm/memblock.c */
+extern void memblock_add(unsigned long base, unsigned long size);
+
+/* mm/memblock.c */
+extern void memblock_reserve(unsigned long base, unsigned long size);
+
+/* mm/memblock.c */
+extern void memblock_free(unsigned long base, unsigned long size);
+
+/* mm/memblock.c */
+extern int memblock_next_free_range(unsigned long *idx, unsigned long *start, unsigned long *end);
+
+/* mm/memblock.c */
+extern unsigned long memblock_find_in_range(unsigned long start, unsigned long end, unsigned long size,
+                                            unsigned long align, unsigned long *pad);
+
+/* mm/memblock.c */
+extern void memblock_set_current_limit(unsigned long limit);
+
+/* mm/memblock.c */
+extern void memblock_dump(void);
+
+/* 从低地址到高地址遍历每一段空闲内存[*start, *end)，i是unsigned long类型的游标 */
+#define for_each_free_mem_range(i, start, end) \
+    for (i = 0; memblock_next_free_range(&i, start, end);)
+
+#endif /* _LINUX_MEMBLOCK_H */
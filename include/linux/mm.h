@@ -10,6 +10,15 @@
 #include <asm-i386/pgtable.h>
 #include <asm-i386/atomic.h>
 
+/* 用于表示分配请求可以睡眠等待内存回收的GFP掩码的位 */
+#define __GFP_WAIT 0x01
+
+/* 用于表示高优先级分配请求（可以动用部分保留页面）的GFP掩码的位 */
+#define __GFP_HIGH 0x02
+
+/* 用于表示分配请求可以发起I/O操作（如写回脏页）的GFP掩码的位 */
+#define __GFP_IO 0x04
+
 /* 该宏位于#ifdef CONFIG_HIGHMEM（定义为0x10） 的 #else 下，
 用于表示高端内存区域（HighMem）的分配请求对应的GPF掩码的位 */
 #define __GFP_HIGHMEM 0x0
@@ -17,6 +26,24 @@
 /* 用于表示DMA的分配请求对应的GPF掩码的位 */
 #define __GFP_DMA 0x08
 
+/* 用于表示分配请求想要“冷”页面（内容不需要在cpu缓存中，如用于DMA）的GFP掩码的位 */
+#define __GFP_COLD 0x80
+
+/* 用于表示分配的页面可以被回收（如可收缩的slab缓存）的GFP掩码的位，决定页面的迁移类型 */
+#define __GFP_RECLAIMABLE 0x20
+
+/* 用于表示分配的页面可以被移动（如用户页面与页缓存）的GFP掩码的位，决定页面的迁移类型 */
+#define __GFP_MOVABLE 0x40
+
+/* 不可睡眠的原子分配，如中断上下文中的分配 */
+#define GFP_ATOMIC (__GFP_HIGH)
+
+/* 内核常规分配，可以睡眠，可以发起I/O */
+#define GFP_KERNEL (__GFP_HIGH | __GFP_WAIT | __GFP_IO)
+
+/* 分配位于DMA区域的内存，作为修饰符与其他GFP掩码组合使用 */
+#define GFP_DMA __GFP_DMA
+
 /* page的falgs字段中表示该页被锁定的位（意味着它正在被某个进程或内核线程使用。
 试图释放被锁定的页面会引起竞争条件或内存损坏）相对于flags的位偏移 */
 #define PG_locked 0
@@ -49,33 +76,61 @@
 /* page的falgs字段中表示该页干净的且非活跃的位相对于flags的位偏移 */
 #define PG_inactive_clean 11
 
+/* page的falgs字段中表示该页属于slab分配器的位相对于flags的位偏移，
+这时页面的list字段被slab借用来记录页面属于哪个缓存池与哪个slab */
+#define PG_slab 8
+
+/* page的falgs字段中表示该页是伙伴系统中一个空闲块的第一个页面的位，
+只在CONFIG_BUDDY_PAGE_ORDER下使用，块的阶记录在flags的PG_ORDER_SHIFT开始的4位中 */
+#define PG_buddy 12
+
+/* 空闲块的阶在page的flags字段中的位偏移，共占4位，足够表示MAX_ORDER以内的阶 */
+#define PG_ORDER_SHIFT 24
+
+/* 空闲块的阶在page的flags字段中的掩码 */
+#define PG_ORDER_MASK (0xfUL << PG_ORDER_SHIFT)
+
+/* 页面位于冷热页缓存中时，记录它是按哪种迁移类型放进缓存的，在page的flags字段中的位偏移，共占2位 */
+#define PG_MIGRATE_SHIFT 28
+
+/* 页面迁移类型在page的flags字段中的掩码 */
+#define PG_MIGRATE_MASK (0x3UL << PG_MIGRATE_SHIFT)
+
+/* 页面所属zone的编号在page的flags字段中的位偏移，共占2位，足够表示MAX_NR_ZONES个zone */
+#define ZONE_SHIFT 22
+
+/* 页面所属zone的编号在page的flags字段中的掩码 */
+#define ZONE_MASK (0x3UL << ZONE_SHIFT)
+
 /* page的falgs字段中表示该页被保留的位（不能被普通的内存分配器分配）相对于flags的位偏移 */
 #define PG_reserved 31
 
 /* mm/page_alloc.c */
 extern void free_area_init(unsigned long *zones_size);
 
-/* 这个结构体是对一个物理内存页面的抽象 */
+/* 这个结构体是对一个物理内存页面的抽象。每个物理页面都有一个，所以它的大小直接决定了mem_map占用多少内存。
+伙伴系统最常访问的list、flags、count放在最前面，整个结构体正好32字节，mem_map按32字节对齐，
+每个页描述符都落在同一条缓存行内。为此，Linux2.4中的几个字段被去掉了：
+virtual：低端内存页面的虚拟地址可以由页号直接算出，见page_address；
+zone：页面所属zone的编号记录在flags的ZONE_SHIFT开始的2位中，见page_zone；
+wait：等待页面解锁的进程很少，所有页面按哈希共用zone中的等待队列，见page_waitqueue */
 typedef struct page
 {
     /* 用于将页面链接到伙伴系统中，比如order为2的两个块，page256起始的块和page512块都是这么大，
     那么这两个page的这个字段就会链接到管理order为2的free_area_t的链表字段中 */
     struct list_head list;
+    unsigned long flags; /* 一组位标志，表示页面的不同状态和属性（如脏、活跃、锁定等），高位还记录了所属zone */
+    atomic_t count;      /* 引用计数，表示有多少实体正在使用这个页面。当计数降至0时，页面可以被回收 */
     /* 该页所属的地址空间。如果这个页面是文件映射页，mapping 将指向文件的 address_space 结构 */
     struct address_space *mapping;
-    // unsigned long index;           /* 在 address_space 中的页面索引。对于文件映射页，它表示该页在文件中的偏移量 */
+    unsigned long index; /* 在 address_space 中的页面索引。对于文件映射页，它表示该页在文件中的偏移量 */
     // struct page *next_hash;        /* 用于将页面插入到散列表中，以便快速查找 */
-    atomic_t count;      /* 引用计数，表示有多少实体正在使用这个页面。当计数降至0时，页面可以被回收 */
-    unsigned long flags; /* 一组位标志，表示页面的不同状态和属性（如脏、活跃、锁定等） */
     // struct list_head lru;          /* 用于将页面链接到最近最少使用（LRU）列表中 */
-    unsigned long age;      /* 页面的年龄，用于页面替换算法，帮助确定哪个页面应该被换出 */
-    wait_queue_head_t wait; /* 当页面被锁定时，其他想要访问该页面的进程会在这个等待队列上等待 */
+    unsigned long age; /* 页面的年龄，用于页面替换算法，帮助确定哪个页面应该被换出 */
     // struct page **pprev_hash;      /* 一个指向散列表中前一个页面的指针，用于维护散列表的完整性 */
     /* 如果该页面被用作缓冲区(如文件系统数据，文件系统元数据)，
     这个指针将指向相关的缓冲区头结构 */
     struct buffer_head *buffers;
-    void *virtual;            /* 如果页面被映射到内核虚拟地址空间，这个指针非空，并指向该页面在内核地址空间中的虚拟地址 */
-    struct zone_struct *zone; /* 指向描述该页面所属内存区域的 zone_struct 结构的指针 */
 } mem_map_t;
 
 /* mm/memory.c */
@@ -111,12 +166,62 @@ extern mem_map_t *mem_map;
 /* 返回page的flags中的inactive_clean状态 */
 #define PageInactiveClean(page) test_bit(PG_inactive_clean, &(page)->flags)
 
+/* 返回page的flags中的slab状态，也就是该页是否属于slab分配器 */
+#define PageSlab(page) test_bit(PG_slab, &(page)->flags)
+
+/* 将一个page标记为属于slab分配器 */
+#define PageSetSlab(page) set_bit(PG_slab, &(page)->flags)
+
+/* 清除page属于slab分配器的标记 */
+#define PageClearSlab(page) clear_bit(PG_slab, &(page)->flags)
+
+/* 返回page的flags中的buddy状态，也就是该页是否是伙伴系统中一个空闲块的第一个页面 */
+#define PageBuddy(page) test_bit(PG_buddy, &(page)->flags)
+
+#ifdef CONFIG_BUDDY_PAGE_ORDER
+/* 将page标记为伙伴系统中一个order阶空闲块的第一个页面，调用者需持有zone->lock，
+所以这里直接修改flags，不需要原子操作 */
+#define set_page_order(page, order) \
+    ((page)->flags = ((page)->flags & ~PG_ORDER_MASK) | ((unsigned long)(order) << PG_ORDER_SHIFT) | (1UL << PG_buddy))
+
+/* 清除page的空闲块标记与阶 */
+#define rmv_page_order(page) ((page)->flags &= ~(PG_ORDER_MASK | (1UL << PG_buddy)))
+
+/* 返回page记录的空闲块的阶 */
+#define page_order(page) (((page)->flags & PG_ORDER_MASK) >> PG_ORDER_SHIFT)
+
+/* 判断page是否是一个order阶空闲块的第一个页面，也就是能否与同样大小的伙伴块合并 */
+#define page_is_buddy(page, order) (PageBuddy(page) && page_order(page) == (unsigned long)(order))
+#else
+/* 位图方式下，空闲块的状态记录在free_area_t的位图中，struct page中不需要记录 */
+#define set_page_order(page, order) \
+    do                              \
+    {                               \
+    } while (0)
+
+/* 位图方式下，什么都不用做 */
+#define rmv_page_order(page) \
+    do                       \
+    {                        \
+    } while (0)
+#endif
+
+/* 记录冷热页缓存中page的迁移类型，页面只属于本cpu，直接修改flags */
+#define set_page_migratetype(page, type) \
+    ((page)->flags = ((page)->flags & ~PG_MIGRATE_MASK) | ((unsigned long)(type) << PG_MIGRATE_SHIFT))
+
+/* 返回冷热页缓存中page的迁移类型 */
+#define page_migratetype(page) (((page)->flags & PG_MIGRATE_MASK) >> PG_MIGRATE_SHIFT)
+
 /* 将page的count -1，然后测试页面的count是不是0，如果是就返回1，不是返回0 */
 #define put_page_testzero(p) atomic_dec_and_test(&(p)->count)
 
 /* arch/i386/mm/init.c */
 extern void mem_init(void);
 
+/* arch/i386/mm/init.c */
+extern void show_mem(void);
+
 /* mm/memory.c */
 extern unsigned long max_mapnr;
 
@@ -126,8 +231,79 @@ extern unsigned long num_physpages;
 /* mm/memory.c */
 extern void *high_memory;
 
+/* 得到page对应页面在内核地址空间中的虚拟地址。该宏位于#if defined(CONFIG_HIGHMEM) || defined(WANT_PAGE_VIRTUAL)
+的#else下，我们没有高端内存，所有页面都线性映射在PAGE_OFFSET之上，直接由页号算出 */
+#define page_address(page) __va(((page) - mem_map) << PAGE_SHIFT)
+
+/* mm/page_alloc.c */
+extern zone_t *zone_table[MAX_NR_ZONES];
+
+/* 得到page所属的zone */
+#define page_zone(page) (zone_table[((page)->flags & ZONE_MASK) >> ZONE_SHIFT])
+
+/* 记录page所属zone的编号，只在初始化页描述符时调用 */
+#define set_page_zone(page, zone_num) \
+    ((page)->flags = ((page)->flags & ~ZONE_MASK) | ((unsigned long)(zone_num) << ZONE_SHIFT))
+
+/* 用于计算等待队列哈希值的乘数，一个接近2^32黄金分割点的素数，乘法之后高位充分混合了页描述符地址的各个位 */
+#define GOLDEN_RATIO_PRIME 0x9e370001UL
+
+/* 得到等待page的进程应该睡眠在哪个等待队列上。页描述符中不再各自带一个等待队列，
+而是按页描述符地址哈希到所属zone的wait_table中，哈希冲突时被唤醒的进程需要重新检查自己等待的页面 */
+static inline wait_queue_head_t *page_waitqueue(struct page *page)
+{
+    zone_t *zone = page_zone(page);
+    unsigned long hash = (unsigned long)page;
+
+    hash *= GOLDEN_RATIO_PRIME;
+    hash >>= zone->wait_table_shift; /* 取乘积的高位作为下标 */
+    return &zone->wait_table[hash];
+}
+
+/* mm/page_alloc.c */
+extern struct page *__alloc_pages(zonelist_t *zonelist, unsigned long order);
+
+/* 从伙伴系统中分配2的order次方个连续的页面，参数：
+gfp_mask：分配请求的GFP掩码，决定了使用哪一个zonelist（也就是可以从哪些zone中分配）
+order：要分配的页面数，以 2 的幂为单位
+返回：分配到的第一个页面的struct page，失败返回NULL */
+static inline struct page *alloc_pages(int gfp_mask, unsigned long order)
+{
+    if (order >= MAX_ORDER) /* 伙伴系统最大只能分配2的MAX_ORDER-1次方个页面 */
+        return NULL;
+    /* 我们只有一个内存节点，所以直接用contig_page_data中与gfp_mask对应的zonelist */
+    return __alloc_pages(contig_page_data.node_zonelists + (gfp_mask), order);
+}
+
+/* 从伙伴系统中分配一个页面 */
+#define alloc_page(gfp_mask) alloc_pages(gfp_mask, 0)
+
+/* mm/page_alloc.c */
+extern unsigned long __get_free_pages(int gfp_mask, unsigned long order);
+
+/* mm/page_alloc.c */
+extern unsigned long get_zeroed_page(int gfp_mask);
+
+/* 从伙伴系统中分配一个页面，返回的是其虚拟地址 */
+#define __get_free_page(gfp_mask) __get_free_pages((gfp_mask), 0)
+
+/* mm/page_alloc.c */
+extern void __free_pages(struct page *page, unsigned long order);
+
+/* mm/page_alloc.c */
+extern void free_pages(unsigned long addr, unsigned long order);
+
+/* mm/page_alloc.c */
+extern void free_hot_page(struct page *page);
+
+/* mm/page_alloc.c */
+extern void free_cold_page(struct page *page);
+
 /* 释放一个页，调用的是伙伴系统释放接口，将这个页面的释放视作
 对一个4KB块的释放 */
 #define __free_page(page) __free_pages((page), 0)
 
+/* 通过虚拟地址释放一个页面 */
+#define free_page(addr) free_pages((addr), 0)
+
 #endif /* _LINUX_MM_H */
\ No newline at end of file
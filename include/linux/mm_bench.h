@@ -0,0 +1,38 @@
+#ifndef _LINUX_MM_BENCH_H
+#define _LINUX_MM_BENCH_H
+/* 内存分配器的压力测试与性能基准。在start_kernel中、内存初始化完成后跑一遍随机的分配/释放序列，
+用时间戳计数器给每次操作计时，校验分配出去的内存没有被重复分配、全部释放后空闲页数回到原值，并打印延迟分布。
+同样的代码也可以用make mmtest在宿主机上编译运行（见tools/mmtest/mmtest.c），不需要启动qemu */
+
+#include <linux/init.h>
+#include <asm-i386/timex.h>
+
+/* 打开后在启动时运行内存分配器基准测试，默认关闭，因为它会拖慢启动并打乱伙伴系统的空闲链表 */
+// #define CONFIG_MM_BENCH
+
+/* 延迟直方图的桶数，第i个桶统计耗时在[2^i, 2^(i+1))个时钟周期内的操作 */
+#define BENCH_HIST_BUCKETS 32
+
+/* 一类操作的延迟直方图 */
+struct bench_hist
+{
+    unsigned long bucket[BENCH_HIST_BUCKETS]; /* 按耗时的log2分桶的计数 */
+    unsigned long nr;                         /* 操作总次数 */
+    cycles_t total;                           /* 总耗时（周期数） */
+    cycles_t max;                             /* 最大耗时（周期数） */
+};
+
+#ifdef CONFIG_MM_BENCH
+/* mm/mm_bench.c */
+extern void bench_hist_init(struct bench_hist *hist);
+extern void bench_hist_add(struct bench_hist *hist, cycles_t cycles);
+extern void bench_hist_show(const char *name, struct bench_hist *hist);
+extern unsigned long bench_random(void);
+extern void mm_bench(void);
+
+/* mm/bootmem.c */
+extern unsigned long bootmem_find_free_bitwise(unsigned long *map, unsigned long eidx, unsigned long preferred,
+                                               unsigned long areasize, unsigned long incr);
+#endif
+
+#endif /* _LINUX_MM_BENCH_H */
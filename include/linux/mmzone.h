@@ -4,6 +4,12 @@
 zone结构体：在Linux内核中用于描述和管理物理内存的不同区域。
 每个zone都代表了一个特定的连续的物理内存范围。zone结构体中包含了很多与该内存区域相关的信息 */
 
+#include <linux/spinlock.h>
+#include <linux/list.h>
+#include <linux/cache.h>
+#include <linux/threads.h>
+#include <linux/init.h>
+#include <linux/wait.h>
 
 
 /* 这个常量通常用于指定内存分配请求类型的数量。在内存管理上下文中，GFP（Get Free Page）标志用于指定不同类型的内存分配请求。
@@ -15,14 +21,109 @@ zone结构体：在Linux内核中用于描述和管理物理内存的不同区
 /* 定义了“伙伴系统”（buddy allocator）中使用的最大阶数 */
 #define MAX_ORDER 10
 
+/* Linux2.4的伙伴系统为每个阶维护一张位图，每个位记录一对伙伴块中是否恰好有一个空闲，
+释放时每合并一次就要修改一张不同的位图，最多涉及10条不同的缓存行，位图本身还要占用引导内存。
+定义这个宏后，伙伴系统改为在空闲块第一个页面的struct page中记录PG_buddy标志与块的阶，
+判断伙伴块能否合并只需读取伙伴块的struct page，也不再为位图分配内存。
+默认关闭，使用Linux2.4原有的位图方式 */
+// #define CONFIG_BUDDY_PAGE_ORDER
+
+/* free_area_init_core原本要为节点中的每一个页面初始化struct page，内存越大启动越慢。
+定义这个宏后，启动时只同步初始化前DEFERRED_INIT_SYNC_PAGES个页面（至少覆盖整个DMA区域）的页描述符，
+其余的页描述符连同它们的释放推迟到启动的最后（page_alloc_init_late）按块完成，
+在此之前如果某个zone的空闲页面不足，伙伴系统会先就地初始化并释放一块。
+默认关闭，启动时一次性初始化所有页描述符 */
+// #define CONFIG_DEFERRED_STRUCT_PAGE_INIT
+
+/* 启动时同步初始化的页描述符个数，128MB */
+#define DEFERRED_INIT_SYNC_PAGES ((128UL << 20) >> PAGE_SHIFT)
+
+/* 延迟初始化每次处理的页面数，16MB */
+#define DEFERRED_INIT_CHUNK_PAGES ((16UL << 20) >> PAGE_SHIFT)
+
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+/* 延迟初始化会在启动的后期甚至在分配页面时调用，用到的函数不能放在初始化段中 */
+#define __defermem_init
+#else
+#define __defermem_init __init
+#endif
+
+/* 按页面的可移动性（迁移类型）把空闲块分组。内核自己使用的页面（页表、task_struct、slab等）
+一旦分配出去就再也无法移动，如果它们散落在整个zone中，就会把大块连续的空闲内存切碎，
+即使空闲页面很多，高阶分配也会失败。所以每个阶的空闲块按迁移类型分别挂在不同的链表上，
+zone按pageblock（2的pageblock_order次方个页面）划分所有权，一种迁移类型的分配优先在属于自己的pageblock中进行，
+只有自己的pageblock中没有空闲块时才向其他类型借用，借用较大的块时会把整个pageblock的所有权一起拿过来，
+这样不可移动的页面会聚集在少数pageblock中，其余pageblock释放后仍然可以合并成完整的大块 */
+
+/* 不可移动的页面，如页表、内核数据结构 */
+#define MIGRATE_UNMOVABLE 0
+
+/* 不可移动但可以回收的页面，如可收缩的slab缓存（dentry、inode） */
+#define MIGRATE_RECLAIMABLE 1
+
+/* 可以移动的页面，如用户进程的匿名页与页缓存 */
+#define MIGRATE_MOVABLE 2
+
+/* 迁移类型的数量 */
+#define MIGRATE_TYPES 3
+
+/* pageblock的阶，也就是划分迁移类型所有权的粒度，取伙伴系统的最大阶，
+这样合并出的最大的块恰好是一个完整的pageblock，合并永远不会跨越两个pageblock */
+#define pageblock_order (MAX_ORDER - 1)
+
+/* 一个pageblock中的页面数 */
+#define pageblock_nr_pages (1UL << pageblock_order)
+
 /* 在伙伴内存分配系统中用于抽象每个2的order阶的内存块池，
 它抽象的是内存池，这个内存池用于2的order阶内存块分配 */
 typedef struct free_area_struct
 {
-    struct list_head free_list; /* 用于链接所有同一大小的空闲内存块 */
-    unsigned int *map;          /* 指向位图的指针，这个位图用于表示内存块的占用情况 */
+    struct list_head free_list[MIGRATE_TYPES]; /* 按迁移类型分别链接所有同一大小的空闲内存块 */
+#ifndef CONFIG_BUDDY_PAGE_ORDER
+    unsigned int *map; /* 指向位图的指针，这个位图用于表示内存块的占用情况 */
+#endif
 } free_area_t;
 
+/* 每个cpu私有的0阶页面缓存，位于伙伴系统之前。单页的分配与释放只操作这些链表，
+只有当缓存中的页面过少或过多时，才以batch为单位与伙伴系统批量交换页面 */
+typedef struct per_cpu_pages
+{
+    int count;                             /* 所有链表中的页面总数 */
+    int low;                               /* 页面数不超过low时，从伙伴系统补充一批 */
+    int high;                              /* 页面数达到high时，向伙伴系统归还一批 */
+    int batch;                             /* 每批补充或归还的页面数 */
+    struct list_head lists[MIGRATE_TYPES]; /* 每种迁移类型一个页面链表，链表头部是最热的页面 */
+} per_cpu_pages_t;
+
+/* 一个cpu在一个zone上的冷热页缓存，按缓存行对齐，避免不同cpu之间的伪共享 */
+typedef struct per_cpu_pageset
+{
+    per_cpu_pages_t pcp[2]; /* 0：热页缓存，1：冷页缓存 */
+} ____cacheline_aligned per_cpu_pageset_t;
+
+/* 一个zone的伙伴系统统计计数，按阶统计，用于观察碎片与锁竞争情况，
+为调整zone_balance_ratio、zone_balance_min与zone_balance_max提供数据。
+计数只是普通的内存自增，不是原子操作。alloc、wmark_low、wmark_min与fail在打开中断的路径上累加，
+中断中的分配恰好同时累加时可能丢失一次，只是近似值；其余计数都在持有zone->lock或关闭本地中断的路径上累加，是准确的 */
+typedef struct zone_stat_struct
+{
+    unsigned long alloc[MAX_ORDER];     /* 每个阶分配成功的次数 */
+    unsigned long free[MAX_ORDER];      /* 每个阶释放的次数 */
+    unsigned long merge[MAX_ORDER];     /* 释放时在每个阶上与伙伴块合并的次数 */
+    unsigned long split[MAX_ORDER];     /* 分配时每个阶的块被对半拆分的次数 */
+    unsigned long wmark_low[MAX_ORDER]; /* 分配时因空闲页面不高于pages_low而跳过该zone的次数 */
+    unsigned long wmark_min[MAX_ORDER]; /* 分配时因空闲页面不高于pages_min而跳过该zone的次数 */
+    unsigned long fail[MAX_ORDER];      /* 以该zone为首选zone的分配最终失败的次数 */
+    unsigned long fallback[MAX_ORDER];  /* 分配时自己迁移类型的链表为空，向其他迁移类型借用该阶的块的次数 */
+    unsigned long pageblock_steal;      /* 借用时把整个pageblock的所有权一起拿过来的次数 */
+    unsigned long lock;                 /* 获取zone->lock的次数 */
+    unsigned long pcp_refill;           /* 冷热页缓存从伙伴系统批量补充的次数 */
+    unsigned long pcp_drain;            /* 冷热页缓存向伙伴系统批量归还的次数 */
+} zone_stat_t;
+
+/* 累加zone统计计数中某一项在order阶上的计数 */
+#define zone_stat_inc(zone, item, order) ((zone)->stat.item[(order)]++)
+
 /* 可以被直接内存访问（Direct Memory Access, DMA）操作所使用的物理内存 */
 #define ZONE_DMA 0
 
@@ -52,6 +153,12 @@ typedef struct zone_struct
     unsigned long pages_min, pages_low, pages_high;
     struct list_head inactive_clean_list; /* 用于管理那些非活跃且清理过的页 */
     free_area_t free_area[MAX_ORDER];     /* 这是一个数组，用于表示不同大小的空闲区域。用于伙伴系统分配内存 */
+    unsigned char *pageblock_type;        /* 每个pageblock属于哪种迁移类型，从引导内存中分配 */
+    wait_queue_head_t *wait_table;        /* 本zone所有页面共用的等待队列哈希表，见page_waitqueue */
+    unsigned long wait_table_size;        /* 哈希表中等待队列的个数，是2的幂 */
+    unsigned long wait_table_shift;       /* 哈希值右移这么多位得到哈希表下标 */
+    per_cpu_pageset_t pageset[NR_CPUS];   /* 每个cpu的冷热页缓存，位于伙伴系统之前 */
+    zone_stat_t stat;                     /* 伙伴系统统计计数 */
     char *name;                           /* 区域的名称 */
     unsigned long size;                   /* 表示该区域的大小 */
 
@@ -92,6 +199,9 @@ typedef struct pglist_data
     unsigned long node_size;        /* 该节点的大小（以页为单位） */
     int node_id;                    /* 节点的ID或编号 */
     struct pglist_data *node_next;  /* 指向下一个pglist_data结构的指针，通常用于通过所有的内存节点进行迭代 */
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+    unsigned long first_deferred_pfn; /* 第一个还没有初始化页描述符的页面在节点中的页号，等于node_size表示全部完成 */
+#endif
 } pg_data_t;
 
 extern pg_data_t *pgdat_list;      /* 定义在page_alloc.c中，用于管理所有节点的pg_data_t形成的单链表 */
@@ -102,6 +212,23 @@ extern void free_area_init_core(int nid, pg_data_t *pgdat, struct page **gmap,
                                 unsigned long *zones_size, unsigned long paddr,
                                 unsigned long *zholes_size, struct page *pmap);
 
+/* mm/page_alloc.c */
+extern void memmap_init_range(pg_data_t *pgdat, unsigned long start, unsigned long end);
+
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+/* mm/bootmem.c */
+extern unsigned long deferred_init_memmap_chunk(pg_data_t *pgdat);
+
+/* mm/page_alloc.c */
+extern void page_alloc_init_late(void);
+#endif
+
+/* mm/page_alloc.c */
+extern void show_zone_stats(void);
+
+/* mm/page_alloc.c */
+extern void show_buddyinfo(void);
+
 /* 目的是对给定的地址 x 进行向上对齐，确保它是 mem_map_t 类型大小的整数倍 */
 #define MAP_ALIGN(x) ((((x) % sizeof(mem_map_t)) == 0) ? (x) : ((x) + sizeof(mem_map_t) - ((x) % sizeof(mem_map_t))))
 
@@ -24,6 +24,10 @@
 该任务是否使用过浮点单元（FPU，Floating Point Unit）*/
 #define PF_USEDFPU 0x00100000 /* task used FPU this quantum (SMP) */
 
+/* task_struct的flags一个标志位，表示该任务正在为回收内存而分配内存（如kswapd），
+伙伴系统分配时可以无视水位线，动用最后的保留页面 */
+#define PF_MEMALLOC 0x00000800 /* Allocating memory */
+
 /* 进程或线程的身份证 */
 struct task_struct
 {
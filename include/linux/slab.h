@@ -3,18 +3,109 @@
 
 #include <linux/mm.h>
 
-/* mm/slab.c */
-extern void kmem_cache_init(void);
-
 typedef struct kmem_cache_s kmem_cache_t;
 
+/* 打开后slab分配器带上调试检查：每个缓存池的对象前后加红区、释放后填充毒化字节、
+释放时检查重复释放，并记录最后一次分配或释放对象的调用者。默认关闭，关闭时分配与释放路径上没有任何多余的指令。
+遍历空闲对象链检查重复释放（SLAB_DEBUG_FREE）只对创建时传入它的缓存池打开，这样的缓存池没有每个cpu的对象数组 */
+// #define CONFIG_DEBUG_SLAB
+
+/* 向slab分配器申请对象时使用的标志，实际就是分配页面时的GFP掩码 */
+
+/* 不可睡眠的原子分配 */
+#define SLAB_ATOMIC GFP_ATOMIC
+
+/* 内核常规分配 */
+#define SLAB_KERNEL GFP_KERNEL
+
+/* 分配位于DMA区域的对象，只能用于创建时带有SLAB_CACHE_DMA的缓存池 */
+#define SLAB_DMA GFP_DMA
+
+/* 上面几种分配标志所占用的位 */
+#define SLAB_LEVEL_MASK (__GFP_WAIT | __GFP_HIGH | __GFP_IO)
+
+/* 缓存池中没有空闲对象时不要增长，直接返回NULL */
+#define SLAB_NO_GROW 0x00002000UL
+
+/* 传给对象构造函数的标志 */
+
+/* 构造对象。Linux2.4中构造函数还会被用来校验对象（SLAB_CTOR_VERIFY），我们只用于构造 */
+#define SLAB_CTOR_CONSTRUCTOR 0x001UL
+
+/* 触发这次构造的分配不能睡眠，构造函数也不能睡眠 */
+#define SLAB_CTOR_ATOMIC 0x002UL
+
 /* kmem_cache_t结构体flags的值 */
 
+/* kmem_cache_t 的 flags 值，释放对象时遍历slab的空闲对象链，检查对象是不是已经释放过了，只在CONFIG_DEBUG_SLAB下生效 */
+#define SLAB_DEBUG_FREE 0x00000100UL
+
+/* kmem_cache_t 的 flags 值，在对象之后记录最后一次分配或释放它的调用者，只在CONFIG_DEBUG_SLAB下生效 */
+#define SLAB_STORE_USER 0x00000200UL
+
+/* kmem_cache_t 的 flags 值，在对象前后各放一个字的红区，用于发现越界写与重复分配释放，只在CONFIG_DEBUG_SLAB下生效 */
+#define SLAB_RED_ZONE 0x00000400UL
+
+/* kmem_cache_t 的 flags 值，对象释放后填满毒化字节，分配时检查它们没有被改写过，
+用于发现释放后继续使用，只在CONFIG_DEBUG_SLAB下生效 */
+#define SLAB_POISON 0x00000800UL
+
+/* kmem_cache_t 的 flags 值，缓存池不会在内存紧张时被回收（reap） */
+#define SLAB_NO_REAP 0x00001000UL
+
+/* kmem_cache_t 的 flags 值，对象按cpu缓存行对齐 */
+#define SLAB_HWCACHE_ALIGN 0x00002000UL
+
+/* kmem_cache_t 的 flags 值，slab的页面从DMA区域分配 */
+#define SLAB_CACHE_DMA 0x00004000UL
+
+/* kmem_cache_t 的 flags 值，缓存池中的对象可以被回收（如dentry、inode），
+slab的页面按MIGRATE_RECLAIMABLE分配，不要和内核其他不可移动的页面混在一个pageblock中 */
+#define SLAB_RECLAIM_ACCOUNT 0x00008000UL
+
 /* kmem_cache_t 的 flags 值，用于指示 slab 管理数据结构是存放在它们所管理的缓存块中，
 还是放在专门的内存缓存区（一个单独的 slab）中 */
 #define CFLGS_OFF_SLAB 0x010000UL
 
-/* kmem_cache_t 的 flags 值，缓存池不会在内存紧张时被回收（reap） */
-#define SLAB_NO_REAP 0x00001000UL
+/* mm/slab.c */
+extern void kmem_cache_init(void);
+
+/* mm/slab.c */
+extern void kmem_cache_sizes_init(void);
+
+/* mm/slab.c */
+extern void kmem_cpucache_init(void);
+
+/* mm/slab.c */
+extern kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t offset, unsigned long flags,
+                                       void (*ctor)(void *, kmem_cache_t *, unsigned long),
+                                       void (*dtor)(void *, kmem_cache_t *, unsigned long));
+
+/* mm/slab.c */
+extern int kmem_cache_destroy(kmem_cache_t *cachep);
+
+/* mm/slab.c */
+extern int kmem_cache_shrink(kmem_cache_t *cachep);
+
+/* mm/slab.c */
+extern void *kmem_cache_alloc(kmem_cache_t *cachep, int flags);
+
+/* mm/slab.c */
+extern void kmem_cache_free(kmem_cache_t *cachep, void *objp);
+
+/* mm/slab.c */
+extern int kmem_cache_reap(void);
+
+/* mm/slab.c */
+extern void show_slabinfo(void);
+
+/* mm/slab.c */
+extern kmem_cache_t *kmem_find_general_cachep(size_t size, int gfpflags);
+
+/* mm/slab.c */
+extern void *kmalloc(size_t size, int flags);
+
+/* mm/slab.c */
+extern void kfree(const void *objp);
 
-#endif /* _LINUX_SLAB_H */
\ No newline at end of file
+#endif /* _LINUX_SLAB_H */
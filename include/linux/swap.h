@@ -9,4 +9,7 @@
 /* mm/swap.c */
 extern int memory_pressure;
 
+/* mm/page_alloc.c */
+extern unsigned int nr_free_pages(void);
+
 #endif /* _LINUX_SWAP_H */
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <linux/init.h>
 #include <linux/smp_lock.h>
 #include <linux/bootmem.h>
+#include <linux/mm_bench.h>
 #include <asm-i386/io.h>
 
 /* arch/i386/kernel/setup.c */
@@ -101,6 +102,22 @@ asmlinkage void __init start_kernel(void)
     计算被保留的页面数，计算内核代码段，数据段，初始化段大小，
     通过遍历用户空间的页目录表项，来清除低地址映射 */
     mem_init();
+    /* 创建kmalloc使用的32字节到128KB的通用缓存池 */
+    kmem_cache_sizes_init();
+    /* 为每个slab缓存池启用每个cpu的对象数组，之后的分配释放大多不用访问slab。
+    对象数组本身要从slab中分配，所以必须等mem_init把空闲页面交给伙伴系统之后 */
+    kmem_cpucache_init();
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+    /* 完成启动时推迟的页描述符初始化，并把这些页面交给伙伴系统。
+    将来更多的初始化工作应当放在它之前，在这之前伙伴系统需要更多页面时会自己按块初始化 */
+    page_alloc_init_late();
+#endif
+    /* 打印内存使用情况与伙伴系统统计计数，Linux2.4中由SysRq-M触发，我们还没有键盘驱动，在这里调用一次 */
+    show_mem();
+#ifdef CONFIG_MM_BENCH
+    /* 在启动时对内存分配器做随机压力测试与性能基准 */
+    mm_bench();
+#endif
     while (1)
         ;
 }
\ No newline at end of file
@@ -13,8 +13,10 @@ bootmem.c 中的引导内存分配器就会被淘汰，系统转而使用更高
 #include <linux/init.h>
 #include <linux/bootmem.h>
 #include <linux/mmzone.h>
+#include <linux/mm_bench.h>
 #include <asm-i386/dma.h>
 
+#ifndef CONFIG_NO_BOOTMEM
 /* 初始化一个节点的引导内存管理器。它设置了一个位图来跟踪哪些页面是可用的，哪些是已经被占用的。参数：
 pg_data_t *pgdat: 指向一个包含节点（node）相关数据的结构，该结构抽象了一个内存节点
 unsigned long mapstart: 引导内存位图的起始地址。
@@ -45,7 +47,6 @@ addr: 要释放的内存的起始地址；
 size：要释放的内存的大小 */
 static void __init free_bootmem_core(bootmem_data_t *bdata, unsigned long addr, unsigned long size)
 {
-    unsigned long i;                                                         /* 循环变量 */
     unsigned long start;                                                     /* 存储距离起始地址向上最近页的页帧号 */
     unsigned long sidx;                                                      /* 存储距离起始地址向上最近页在页面位图中的索引 */
     unsigned long eidx = (addr + size - bdata->node_boot_start) / PAGE_SIZE; /* 计算结束地址向下最近页在页面位图中的索引 */
@@ -59,12 +60,10 @@ static void __init free_bootmem_core(bootmem_data_t *bdata, unsigned long addr,
     start = (addr + PAGE_SIZE - 1) / PAGE_SIZE;          /* 计算距离起始地址向上最近页的页帧号 */
     sidx = start - (bdata->node_boot_start / PAGE_SIZE); /* 计算距离起始地址向上最近页在页面位图中的索引 */
 
-    for (i = sidx; i < eidx; i++)
-    {
-        /* 使用 test_and_clear_bit 函数测试并清除 bdata->node_bootmem_map 中的位。如果位已经被清除（即函数返回 0），则触发 BUG() 宏 */
-        if (!test_and_clear_bit(i, bdata->node_bootmem_map))
-            BUG();
-    }
+    /* 引导期间只有一个执行流，不需要逐页用带锁的test_and_clear_bit，整段清0，
+    setup_arch登记的e820区域往往有几十万页，中间整个的long一次写完。如果有位已经被清除，则触发 BUG() 宏 */
+    if (sidx < eidx && bitmap_clear(bdata->node_bootmem_map, sidx, eidx - sidx))
+        BUG();
 }
 
 /* 系统引导期间保留一段特定的物理内存。通过操作位图来跟踪哪些页面已被保留，确保不会重复使用这些页面，参数：
@@ -73,7 +72,6 @@ addr:要保留内存的起始地址。
 size: 要保留的内存大小。 */
 static void __init reserve_bootmem_core(bootmem_data_t *bdata, unsigned long addr, unsigned long size)
 {
-    unsigned long i; /* 循环变量 */
     /* 这里考虑了页对齐，任何部分占用的页都会被完全保留 */
     unsigned long sidx = (addr - bdata->node_boot_start) / PAGE_SIZE;                        /* 向下取整计算起始页在引导内存分配器位图中的索引 */
     unsigned long eidx = (addr + size - bdata->node_boot_start + PAGE_SIZE - 1) / PAGE_SIZE; /* 向上取整计算结束页在引导内存分配器位图中的索引 */
@@ -84,11 +82,47 @@ static void __init reserve_bootmem_core(bootmem_data_t *bdata, unsigned long add
 
     if (end > bdata->node_low_pfn) /* 如果计算出的 end 值超过了节点的最低物理帧号，也触发 BUG() 宏 */
         BUG();
-    for (i = sidx; i < eidx; i++)
-        if (test_and_set_bit(i, bdata->node_bootmem_map))              /* 测试并设置引导内存映射中相应的位（置1）。如果该位已经被设置，表示该页已经被保留 */
-            printk("hm, page %08lx reserved twice.\n", i * PAGE_SIZE); /* 如果某个页面已经被保留（即 test_and_set_bit 返回真），则打印一条消息，表明该页已被两次保留 */
+    /* 整段置1，如果其中有页面已经被保留，打印一条消息，表明有页面被两次保留 */
+    if (bitmap_set(bdata->node_bootmem_map, sidx, eidx - sidx))
+        printk("hm, pages in %08lx-%08lx reserved twice.\n", sidx * PAGE_SIZE, eidx * PAGE_SIZE - 1);
+}
+#else
+/* 初始化一个节点的引导内存管理器。memblock的区间表是全局静态的，这里只记下节点管理的页帧范围，
+不需要位图，返回的位图大小为0，mapstart不用。可用内存由setup_arch用memblock_add登记。参数同上 */
+static unsigned long __init init_bootmem_core(pg_data_t *pgdat, unsigned long mapstart, unsigned long start, unsigned long end)
+{
+    bootmem_data_t *bdata = pgdat->bdata;
+
+    (void)mapstart;
+    pgdat->node_next = pgdat_list;
+    pgdat_list = pgdat;
+    bdata->node_bootmem_map = NULL;
+    bdata->node_boot_start = (start << PAGE_SHIFT);
+    bdata->node_low_pfn = end;
+    return 0;
 }
 
+/* 把一段内存还给引导内存分配器，按字节记录，不足一页的部分在交给伙伴系统时才舍去 */
+static void __init free_bootmem_core(bootmem_data_t *bdata, unsigned long addr, unsigned long size)
+{
+    if (!size)
+        BUG();
+    if (addr + size > (bdata->node_low_pfn << PAGE_SHIFT))
+        BUG();
+    memblock_free(addr, size);
+}
+
+/* 保留一段内存 */
+static void __init reserve_bootmem_core(bootmem_data_t *bdata, unsigned long addr, unsigned long size)
+{
+    if (!size)
+        BUG();
+    if (addr + size > (bdata->node_low_pfn << PAGE_SHIFT))
+        BUG();
+    memblock_reserve(addr, size);
+}
+#endif
+
 unsigned long max_low_pfn; /* 记录内存管理系统可管理的最大物理页面号 */
 unsigned long min_low_pfn; /* 记录内存管理系统可管理的起始页面帧号 */
 
@@ -120,15 +154,161 @@ void __init reserve_bootmem(unsigned long addr, unsigned long size)
     reserve_bootmem_core(contig_page_data.bdata, addr, size); /* 调用函数来保留内存 */
 }
 
+/* 在引导内存分配器的位图中找一段连续的空闲页面。Linux2.4对每个候选起始页逐位检查后面areasize个页面，
+遇到被占用的页面就换下一个候选页面重新检查，一段长度为L的空闲区段放不下时要检查约L*L/2位。
+这里一次检查一个long：用find_next_zero_bit跳过全被占用的long找到候选起始页，
+再用find_next_bit找到这段空闲区段的结尾，区段不够长时，这段区段里的其他候选页面也不可能够长，
+直接从区段结尾之后继续找，每一位最多被看一次。参数：
+map：位图
+eidx：位图的位数
+preferred：从这一页开始找，是incr的整数倍
+areasize：需要的页面数
+incr：起始页面必须是它的整数倍，是2的幂
+返回：找到的起始页面，找不到返回eidx */
+unsigned long __init bootmem_find_free(unsigned long *map, unsigned long eidx, unsigned long preferred,
+                                       unsigned long areasize, unsigned long incr)
+{
+    unsigned long i = preferred, end;
+
+    while (i < eidx)
+    {
+        i = find_next_zero_bit(map, eidx, i); /* 第一个空闲页面 */
+        i = (i + incr - 1) & ~(incr - 1);     /* 向上对齐到候选的起始页面 */
+        if (i >= eidx)
+            break;
+        if (test_bit(i, map)) /* 对齐之后落在了被占用的页面上 */
+            continue;
+        end = find_next_bit(map, eidx, i); /* 空闲区段的结尾 */
+        if (end - i >= areasize)
+            return i;
+        i = end;
+    }
+    return eidx;
+}
+
+#ifdef CONFIG_MM_BENCH
+/* Linux2.4中__alloc_bootmem_core逐位检查的查找方法，只留给基准测试与bootmem_find_free比较，参数与返回值同bootmem_find_free */
+unsigned long __init bootmem_find_free_bitwise(unsigned long *map, unsigned long eidx, unsigned long preferred,
+                                               unsigned long areasize, unsigned long incr)
+{
+    unsigned long i, j;
+
+    for (i = preferred; i < eidx; i += incr)
+    {
+        if (test_bit(i, map))
+            continue;
+        for (j = i + 1; j < i + areasize; ++j)
+        {
+            if (j >= eidx)
+                goto fail_block;
+            if (test_bit(j, map))
+                goto fail_block;
+        }
+        return i;
+    fail_block:;
+    }
+    return eidx;
+}
+#endif
+
+/* 引导内存分配记录表的项数。连续几次调用者与参数都相同的分配（比如逐个分配的页表）合并成一项，
+表满之后的分配只计入总数 */
+#define BOOTMEM_TRACE_MAX 64
+
+/* 一次或连续几次相同的引导内存分配的记录 */
+struct bootmem_trace
+{
+    void *caller;        /* 调用__alloc_bootmem或__alloc_bootmem_node的地方 */
+    unsigned long size;  /* 每次请求的字节数 */
+    unsigned long align; /* 请求的对齐 */
+    unsigned long goal;  /* 请求的目标物理地址 */
+    unsigned long addr;  /* 第一次分配得到的物理地址 */
+    unsigned long pad;   /* 与上一次分配共用页面时，为了对齐跳过的字节数之和 */
+    unsigned long nr;    /* 合并了几次分配 */
+};
+
+static struct bootmem_trace bootmem_trace[BOOTMEM_TRACE_MAX] __initdata;
+static unsigned long bootmem_trace_nr __initdata;    /* 记录表中用了几项 */
+static unsigned long bootmem_trace_lost __initdata;  /* 表满之后没有记下的分配次数 */
+static unsigned long bootmem_trace_calls __initdata; /* 分配的总次数 */
+static unsigned long bootmem_trace_bytes __initdata; /* 请求的总字节数 */
+static unsigned long bootmem_trace_used __initdata;  /* 分配实际占用的总字节数 */
+static unsigned long bootmem_trace_pad __initdata;   /* 为了对齐跳过的总字节数 */
+
+/* 记下一次引导内存分配，参数：
+caller：调用者
+size、align、goal：分配的参数
+addr：分配得到的物理地址
+pad：为了对齐跳过的字节数
+used：这次分配新占用的字节数，位图方式下是新占用的整页，与上次分配共用的页面不算 */
+static void __init bootmem_trace_add(void *caller, unsigned long size, unsigned long align, unsigned long goal,
+                                     unsigned long addr, unsigned long pad, unsigned long used)
+{
+    struct bootmem_trace *t;
+
+    bootmem_trace_calls++;
+    bootmem_trace_bytes += size;
+    bootmem_trace_used += used;
+    bootmem_trace_pad += pad;
+
+    if (bootmem_trace_nr) /* 和上一项相同就合并 */
+    {
+        t = &bootmem_trace[bootmem_trace_nr - 1];
+        if (t->caller == caller && t->size == size && t->align == align && t->goal == goal)
+        {
+            t->nr++;
+            t->pad += pad;
+            return;
+        }
+    }
+    if (bootmem_trace_nr == BOOTMEM_TRACE_MAX)
+    {
+        bootmem_trace_lost++;
+        return;
+    }
+    t = &bootmem_trace[bootmem_trace_nr++];
+    t->caller = caller;
+    t->size = size;
+    t->align = align;
+    t->goal = goal;
+    t->addr = addr;
+    t->pad = pad;
+    t->nr = 1;
+}
+
+/* 在引导内存交给伙伴系统时打印引导期间的内存都被谁用掉了，以及有多少浪费在对齐与页面末尾上。
+调用者是返回地址，可以在System.map中查到所在的函数 */
+static void __init bootmem_trace_show(void)
+{
+    unsigned long i;
+    struct bootmem_trace *t;
+
+    printk("bootmem: %lu allocations, %lu bytes requested, %lu bytes used, %lu bytes alignment padding, %lu bytes wasted\n",
+           bootmem_trace_calls, bootmem_trace_bytes, bootmem_trace_used, bootmem_trace_pad,
+           bootmem_trace_used - bootmem_trace_bytes);
+    for (i = 0; i < bootmem_trace_nr; i++)
+    {
+        t = &bootmem_trace[i];
+        printk("bootmem: caller %p %4lu x %8lu bytes align %4lu goal %08lx at %08lx pad %lu\n",
+               t->caller, t->nr, t->size, t->align, t->goal, t->addr, t->pad);
+    }
+    if (bootmem_trace_lost)
+        printk("bootmem: %lu more allocations not listed\n", bootmem_trace_lost);
+}
+
+#ifndef CONFIG_NO_BOOTMEM
 /* 用于在系统引导时分配内存,基本原理：扫描内存节点对应的引导内存分配器的位图来进行分配，
 但是这样的分配会引发内存碎片，所以在这个机制下又添加了内存分配合并策略，也就是传统的顺序分配。参数：
 bdata:指向引导内存分配器的指针。
 size: 这是要分配的内存块的大小。
 align: 指定了分配的内存的起始地址必须满足的对齐方式。
-goal: 指定了内存分配应该尽可能从哪个物理地址开始。 */
-static void *__init __alloc_bootmem_core(bootmem_data_t *bdata, unsigned long size, unsigned long align, unsigned long goal)
+goal: 指定了内存分配应该尽可能从哪个物理地址开始。
+caller: 调用者，记入引导内存分配记录表 */
+static void *__init __alloc_bootmem_core(bootmem_data_t *bdata, unsigned long size, unsigned long align, unsigned long goal,
+                                         void *caller)
 {
-    unsigned long i, start = 0;           /* i用于循环计数，start记录分配的起始位置，初始化为0） */
+    unsigned long pad = 0;                /* 与上次分配共用页面时为了对齐跳过的字节数 */
+    unsigned long start;                  /* start记录分配的起始位置 */
     void *ret;                            /* 返回分配的内存地址 */
     unsigned long offset, remaining_size; /* 返回地址在页内偏移量和页内剩余大小 */
     /* areasize记录需要分配的页数；preferred表示分配首选页面；incr表示页帧增长步长 */
@@ -155,41 +335,16 @@ static void *__init __alloc_bootmem_core(bootmem_data_t *bdata, unsigned long si
     这里使用了一个变体：expr1 ?: expr2。这里如果 expr1 为非零（即真），结果就是 expr1 的值；如果 expr1 为零，结果是 expr2 的值 */
     incr = align >> PAGE_SHIFT ?: 1; /* 计算页帧号增加的步长，如果没有指定对齐，则默认为1 */
 
-restart_scan:
-    /* 遍历页帧号，检查是否有足够的连续空页 */
-    for (i = preferred; i < eidx; i += incr)
-    {
-        unsigned long j;
-        /* 如果当前页帧 i 已被占用，则起始页帧+incr，从之后的位置继续寻找 */
-        if (test_bit(i, bdata->node_bootmem_map))
-            continue;
-        /* 检查从 i+1 到 i + areasize 的所有页帧是否都未被占用 */
-        for (j = i + 1; j < i + areasize; ++j)
-        {
-            /* 如果 j 超过了 eidx，表示没有足够的连续空间，跳转到 fail_block。 */
-            if (j >= eidx)
-                goto fail_block;
-            /* 如果页帧 j 被占用，跳转到 fail_block */
-            if (test_bit(j, bdata->node_bootmem_map))
-                goto fail_block;
-        }
-        /* 如果找到了足够的连续空间，记录起始页帧号 i 到 start，然后跳转到 found */
-        start = i;
-        goto found;
-    fail_block:;
-    }
+    /* 从首选的页帧号开始找足够长的连续空闲页面 */
+    start = bootmem_find_free(bdata->node_bootmem_map, eidx, preferred, areasize, incr);
     /* 如果首选的起始页帧号 preferred 不为0（这意味着首次尝试是从一个非零的特定位置开始的。
-    因为 goal 参数指定了一个优先考虑的内存位置）且没有找到合适的区域，将 preferred 设置为0并重新开始扫描
+    因为 goal 参数指定了一个优先考虑的内存位置）且没有找到合适的区域，从0开始重新扫描
     这种方法允许代码首先尝试满足可能的最佳或优化的内存分配（基于 goal），如果那里没有足够的空间，
     它会退回到一个更通用的搜索，覆盖所有可用的内存空间。 */
-    if (preferred)
-    {
-        preferred = 0;
-        goto restart_scan;
-    }
-found:
-    if (start >= eidx) /* 如果找到的区域起始已经超过了eidx，触发bug宏 */
-        BUG();
+    if (start >= eidx && preferred)
+        start = bootmem_find_free(bdata->node_bootmem_map, eidx, 0, areasize, incr);
+    if (start >= eidx) /* 这个节点上没有足够的连续空闲页面，由调用者去试下一个节点 */
+        return NULL;
 
     /*  这个条件检查是否可以将新的分配与前一个分配合并。如果新请求的对齐小于等于页面大小，
     且之前有分配（bdata->last_offset 非零），且新的分配紧接在上一个分配之后（bdata->last_pos + 1 == start），
@@ -203,6 +358,7 @@ found:
         offset = (bdata->last_offset + align - 1) & ~(align - 1);
         if (offset > PAGE_SIZE) /* 如果计算出的偏移量超出了一个页面的大小，则触发错误 */
             BUG();
+        pad = offset - bdata->last_offset;
         remaining_size = PAGE_SIZE - offset; /* 计算上一个分配的页面中剩余的空间 */
         if (size < remaining_size)           /* 如果请求的大小小于剩余空间，不需要新的页帧；否则，计算还需要多少页帧 */
         {
@@ -227,14 +383,40 @@ found:
         ret = phys_to_virt(start * PAGE_SIZE + bdata->node_boot_start); /*  计算分配的物理地址转换为虚拟地址 */
     }
 
-    /* 遍历分配的每个页帧 */
-    for (i = start; i < start + areasize; i++)
-        /* 标记为已使用，如果已经被标记，则触发错误 */
-        if (test_and_set_bit(i, bdata->node_bootmem_map))
-            BUG();
+    /* 把分配的页帧整段标记为已使用，如果已经被标记，则触发错误 */
+    if (bitmap_set(bdata->node_bootmem_map, start, areasize))
+        BUG();
+    bootmem_trace_add(caller, size, align, goal, __pa(ret), pad, areasize << PAGE_SHIFT);
     memset(ret, 0, size); /* 将分配的内存区域清零 */
     return ret;           /* 返回分配的内存地址 */
 }
+#else
+/* 用于在系统引导时分配内存，memblock方式：在[goal, 节点结束)中从高往低找一段放得下的空闲内存，
+找不到再放宽到整个节点，找到后记入reserved。不同分配之间按字节紧挨着，不需要位图方式下的合并逻辑。参数同上 */
+static void *__init __alloc_bootmem_core(bootmem_data_t *bdata, unsigned long size, unsigned long align, unsigned long goal,
+                                         void *caller)
+{
+    unsigned long limit = bdata->node_low_pfn << PAGE_SHIFT; /* 节点结束的物理地址 */
+    unsigned long addr = 0, pad = 0;
+    void *ret;
+
+    if (!size)
+        BUG();
+
+    if (goal && goal >= bdata->node_boot_start && goal < limit)
+        addr = memblock_find_in_range(goal, limit, size, align, &pad);
+    if (!addr)
+        addr = memblock_find_in_range(bdata->node_boot_start, limit, size, align, &pad);
+    if (!addr) /* 这个节点上没有足够的连续空闲内存，由调用者去试下一个节点 */
+        return NULL;
+
+    memblock_reserve(addr, size);
+    ret = phys_to_virt(addr);
+    bootmem_trace_add(caller, size, align, goal, addr, pad, size + pad);
+    memset(ret, 0, size);
+    return ret;
+}
+#endif
 
 /* 用于在系统引导时分配内存, 参数：
 size: 这是要分配的内存块的大小。
@@ -249,7 +431,7 @@ void *__init __alloc_bootmem(unsigned long size, unsigned long align, unsigned l
     while (pgdat) /* 遍历所有的物理内存节点 */
     {
         /* 在当前节点上尝试分配内存，如果分配成功，函数会返回分配的内存地址 */
-        if ((ptr = __alloc_bootmem_core(pgdat->bdata, size, align, goal)))
+        if ((ptr = __alloc_bootmem_core(pgdat->bdata, size, align, goal, __builtin_return_address(0))))
             return (ptr);
         pgdat = pgdat->node_next; /* 如果当前节点上无法分配足够的内存，函数会移动到下一个内存节点 */
     }
@@ -266,55 +448,196 @@ void *__init __alloc_bootmem_node(pg_data_t *pgdat, unsigned long size, unsigned
 {
     void *ptr;
 
-    ptr = __alloc_bootmem_core(pgdat->bdata, size, align, goal);
+    ptr = __alloc_bootmem_core(pgdat->bdata, size, align, goal, __builtin_return_address(0));
     if (ptr)
         return (ptr);
     BUG();
     return NULL;
 }
 
+/* 将一段连续的空闲页面交给伙伴系统。按照伙伴系统的要求，把这段页面切成尽可能大的、
+在zone内自然对齐（块的起始页在zone中的偏移是块大小的整数倍）且不跨越zone边界的块，
+每个块只调用一次__free_pages，这样伙伴系统既不用为每个页面获取锁与修改位图，
+也不用一层层合并，空闲链表一开始就是合并好的。参数：
+page：第一个页面
+nr：页面数
+返回：交给伙伴系统的页面数 */
+static unsigned long __defermem_init free_bootmem_run(struct page *page, unsigned long nr)
+{
+    unsigned long total = nr; /* 记录总页面数 */
+
+    while (nr)
+    {
+        zone_t *zone = page_zone(page);                      /* 页面所在的内存区域 */
+        unsigned long idx = page - zone->zone_mem_map;       /* 页面在zone中的偏移 */
+        unsigned long left = zone->size - idx;               /* zone中从该页面开始剩余的页面数 */
+        unsigned long order = MAX_ORDER - 1, size, j;
+
+        /* 找到最大的满足对齐、不超过剩余页面数、不跨越zone边界的阶 */
+        while ((idx & ((1UL << order) - 1)) || (1UL << order) > nr || (1UL << order) > left)
+            order--;
+        size = 1UL << order;
+        for (j = 0; j < size; j++)
+            ClearPageReserved(page + j); /* 清除块中每个页面的reserved位 */
+        set_page_count(page, 1);         /* 设置块第一个页面的计数为 1 */
+        __free_pages(page, order);       /* 整个块一次性放入伙伴系统 */
+        page += size;
+        nr -= size;
+    }
+    return total;
+}
+
+#ifndef CONFIG_NO_BOOTMEM
+/* 扫描引导内存分配器位图中第start到第end-1位，把其中空闲的页面交给伙伴系统。
+位图以long为单位扫描，全为1的long（32个页面都被占用）整体跳过，全为0的long整体计入空闲区段，
+找到的每一段连续空闲页面通过free_bootmem_run按最大的对齐块交给伙伴系统。参数：
+pgdat:代表一个节点的内存
+start：开始扫描的位
+end：结束扫描的位（不含）
+返回：释放的页面数 */
+static unsigned long __defermem_init free_bootmem_range(pg_data_t *pgdat, unsigned long start, unsigned long end)
+{
+    struct page *page = pgdat->node_mem_map;              /* 指向该节点页描述符数组 */
+    unsigned long *map = pgdat->bdata->node_bootmem_map; /* 以long为单位访问引导内存分配器的位图 */
+    unsigned long i = start, run, count = 0;             /* i用于循环；run记录空闲区段起始；count统计释放的页面 */
+
+    while (i < end)
+    {
+        /* 位于long边界上，且整个long都是1，说明这32个页面全被占用，整体跳过 */
+        if (!(i % BITS_PER_LONG) && map[i / BITS_PER_LONG] == ~0UL)
+        {
+            i += BITS_PER_LONG;
+            continue;
+        }
+        if (test_bit(i, map)) /* 页面被占用 */
+        {
+            i++;
+            continue;
+        }
+        /* 来到这里，说明找到了一段空闲区段的起始页面，继续向后找到区段的结束 */
+        run = i;
+        while (i < end)
+        {
+            /* 位于long边界上，且整个long都是0，说明这32个页面全部空闲 */
+            if (!(i % BITS_PER_LONG) && i + BITS_PER_LONG <= end && !map[i / BITS_PER_LONG])
+            {
+                i += BITS_PER_LONG;
+                continue;
+            }
+            if (test_bit(i, map))
+                break;
+            i++;
+        }
+        count += free_bootmem_run(page + run, i - run); /* 整段交给伙伴系统 */
+    }
+    return count;
+}
+
+/* 释放用于引导内存分配的位图本身，此后引导内存分配器不再可用。参数：
+pgdat:代表一个节点的内存
+返回：释放的页面数 */
+static unsigned long __defermem_init free_bootmem_map(pg_data_t *pgdat)
+{
+    bootmem_data_t *bdata = pgdat->bdata;
+    unsigned long idx = bdata->node_low_pfn - (bdata->node_boot_start >> PAGE_SHIFT); /* 位图的位数 */
+    unsigned long count;
+
+    /* 引导内存分配器位图所占的页面是连续的，同样整段交给伙伴系统 */
+    count = free_bootmem_run(virt_to_page(bdata->node_bootmem_map), (idx / 8 + PAGE_SIZE - 1) / PAGE_SIZE);
+    bdata->node_bootmem_map = NULL; /* 将引导内存分配器位图置为空 */
+    return count;
+}
+#else
+/* 把节点中第start到第end-1个页面里的空闲页面交给伙伴系统。直接遍历memblock的空闲区间，
+区间两端不足一页的部分舍去，每段整页通过free_bootmem_run按最大的对齐块交给伙伴系统。参数同上 */
+static unsigned long __defermem_init free_bootmem_range(pg_data_t *pgdat, unsigned long start, unsigned long end)
+{
+    struct page *page = pgdat->node_mem_map;
+    unsigned long base = pgdat->bdata->node_boot_start >> PAGE_SHIFT; /* 节点第一个页面的页帧号 */
+    unsigned long i, fstart, fend, count = 0;
+
+    for_each_free_mem_range(i, &fstart, &fend)
+    {
+        fstart = ((fstart + PAGE_SIZE - 1) >> PAGE_SHIFT) - base;
+        fend = (fend >> PAGE_SHIFT) - base;
+        if (fend <= start)
+            continue;
+        if (fstart >= end)
+            break;
+        if (fstart < start)
+            fstart = start;
+        if (fend > end)
+            fend = end;
+        if (fstart < fend)
+            count += free_bootmem_run(page + fstart, fend - fstart);
+    }
+    return count;
+}
+
+/* memblock的区间表是静态数组，没有位图要释放 */
+static unsigned long __defermem_init free_bootmem_map(pg_data_t *pgdat)
+{
+    (void)pgdat;
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+/* 初始化节点中下一块延迟的页描述符，并把其中引导内存分配器没有占用的页面交给伙伴系统，
+最后一块处理完之后释放引导内存分配器的位图。在此之前位图必须保留，它是这些页面是否空闲的唯一记录。参数：
+pgdat:代表一个节点的内存
+返回：释放的页面数 */
+unsigned long deferred_init_memmap_chunk(pg_data_t *pgdat)
+{
+    bootmem_data_t *bdata = pgdat->bdata;
+    unsigned long idx = bdata->node_low_pfn - (bdata->node_boot_start >> PAGE_SHIFT); /* 位图覆盖的页面数 */
+    unsigned long start = pgdat->first_deferred_pfn, end, count = 0;
+
+    if (start >= pgdat->node_size)
+        return 0;
+    /* 每块在页号上按DEFERRED_INIT_CHUNK_PAGES对齐 */
+    end = (start + DEFERRED_INIT_CHUNK_PAGES) & ~(DEFERRED_INIT_CHUNK_PAGES - 1);
+    if (end > pgdat->node_size)
+        end = pgdat->node_size;
+
+    memmap_init_range(pgdat, start, end);
+    pgdat->first_deferred_pfn = end;
+    if (start < idx) /* 高端内存不由引导内存分配器管理 */
+        count = free_bootmem_range(pgdat, start, end < idx ? end : idx);
+    if (end == pgdat->node_size && bdata->node_bootmem_map)
+        count += free_bootmem_map(pgdat);
+    return count;
+}
+#endif
+
 /* 遍历 NUMA 节点的内存页，检查并释放在系统启动期间分配但现在不再需要的内存页，
-以及释放用于引导内存分配的位图本身。参数：
+以及释放用于引导内存分配的位图本身。开启延迟初始化时只处理已经初始化了页描述符的页面，
+位图留给deferred_init_memmap_chunk继续使用。参数：
 pgdat:代表一个节点的内存
-返回：释放的总页面数
-注意：此函数调用了伙伴系统内存分配接口，会导致伙伴系统0阶上挂满4k页面 */
+返回：释放的总页面数 */
 static unsigned long __init free_all_bootmem_core(pg_data_t *pgdat)
 {
-    struct page *page = pgdat->node_mem_map; /* 指向该节点页描述符数组 */
-    bootmem_data_t *bdata = pgdat->bdata;    /* 指向该节点的引导内存数据结构 */
-    unsigned long i, count, total = 0;       /* i用于循环；count统计处理过的页面 ；总页计数器 total */
-    unsigned long idx;                       /* 存储引导内存分配器管理的页面数量 */
+    bootmem_data_t *bdata = pgdat->bdata; /* 指向该节点的引导内存数据结构 */
+    unsigned long idx;                    /* 存储引导内存分配器管理的页面数量 */
+    unsigned long total;                  /* 总页计数器 */
 
+#ifndef CONFIG_NO_BOOTMEM
     if (!bdata->node_bootmem_map) /* 如果引导内存分配器的位图不存在，报错 */
         BUG();
+#endif
+    bootmem_trace_show(); /* 此后不会再有引导内存分配 */
+#ifdef CONFIG_NO_BOOTMEM
+    memblock_dump();
+#endif
 
-    count = 0; /* 初始化为0 */
     /* 计算节点的引导内存分配器可分配的开始地址到最低页面帧号之间的页面数量 */
     idx = bdata->node_low_pfn - (bdata->node_boot_start >> PAGE_SHIFT);
-    for (i = 0; i < idx; i++, page++) /* 循环遍历这些页面 */
-    {
-        if (!test_bit(i, bdata->node_bootmem_map))
-        {                            /* 进来if，说明位图中标识页面的位是0，也就是页面没有分配 */
-            count++;                 /* 处理过的页面 +1 */
-            ClearPageReserved(page); /* 清除页面的reserved位 */
-            set_page_count(page, 1); /* 设置页面计数为 1 */
-            __free_page(page);       /* 释放页面，会导致伙伴系统0阶上挂满4k页面 */
-        }
-    }
-    total += count; /* 更新总释放页面数 */
-
-    page = virt_to_page(bdata->node_bootmem_map); /* 得到引导内存分配器位图的page地址 */
-    count = 0;                                    /* 重新初始化 count */
-    /* 遍历引导内存分配器位图所占的页面 */
-    for (i = 0; i < ((bdata->node_low_pfn - (bdata->node_boot_start >> PAGE_SHIFT)) / 8 + PAGE_SIZE - 1) / PAGE_SIZE; i++, page++)
-    {
-        count++;                 /* 处理过的页面 +1 */
-        ClearPageReserved(page); /* 清除页面的reserved位 */
-        set_page_count(page, 1); /* 设置页面计数为 1 */
-        __free_page(page);       /* 释放页面，会导致伙伴系统0阶上挂满4k页面 */
-    }
-    total += count;                 /* 更新总释放页面数 */
-    bdata->node_bootmem_map = NULL; /* 将引导内存分配器位图置为空 */
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+    if (pgdat->first_deferred_pfn < idx)
+        return free_bootmem_range(pgdat, 0, pgdat->first_deferred_pfn);
+#endif
+    total = free_bootmem_range(pgdat, 0, idx);
+    total += free_bootmem_map(pgdat);
 
     return total; /* 返回释放总页面数量 */
 }
@@ -0,0 +1,229 @@
+/* 按区间管理的引导内存分配器（memblock），打开CONFIG_NO_BOOTMEM后由bootmem.c调用，代替位图。
+位图方式下每个页面占一位，896MB的低端内存要一张28KB的位图，分配时要在位图中逐段查找，
+交给伙伴系统时还要把整张位图扫描一遍。这里只记两张区间表：e820报告的可用内存（memory），
+与已经被占用的内存（reserved），表项数只与内存布局和分配次数有关，一般只有十几项 */
+
+#include <linux/mm.h>
+#include <linux/init.h>
+#include <linux/bootmem.h>
+
+#ifdef CONFIG_NO_BOOTMEM
+
+/* 页表建立之前只能从head.S映射了的前8MB中分配，paging_init建立线性映射后再放开 */
+struct memblock memblock = {.current_limit = MEMBLOCK_INITIAL_LIMIT};
+
+/* 在区间表的第idx项处插入一个区间，后面的区间依次后移，表满说明内存布局过于零碎，直接报错 */
+static void __init memblock_insert_region(struct memblock_type *type, unsigned long idx,
+                                          unsigned long base, unsigned long size)
+{
+    unsigned long i;
+
+    if (type->cnt == INIT_MEMBLOCK_REGIONS)
+        BUG();
+    for (i = type->cnt; i > idx; i--)
+        type->regions[i] = type->regions[i - 1];
+    type->regions[idx].base = base;
+    type->regions[idx].size = size;
+    type->cnt++;
+}
+
+/* 删除区间表的第idx项，后面的区间依次前移 */
+static void __init memblock_remove_region(struct memblock_type *type, unsigned long idx)
+{
+    unsigned long i;
+
+    for (i = idx; i + 1 < type->cnt; i++)
+        type->regions[i] = type->regions[i + 1];
+    type->cnt--;
+}
+
+/* 把[base, base + size)加入区间表，与它重叠或相邻的区间都合并成一个，表仍然有序。参数：
+type：区间表
+base：起始物理地址
+size：字节数 */
+static void __init memblock_add_range(struct memblock_type *type, unsigned long base, unsigned long size)
+{
+    unsigned long end = base + size, i = 0, j;
+    struct memblock_region *r;
+
+    if (!size)
+        return;
+    /* 跳过完全在新区间之前、且与它不相邻的区间 */
+    while (i < type->cnt && type->regions[i].base + type->regions[i].size < base)
+        i++;
+    /* 第i项起，所有与新区间重叠或相邻的区间都并入新区间 */
+    for (j = i; j < type->cnt && type->regions[j].base <= end; j++)
+    {
+        r = &type->regions[j];
+        if (r->base < base)
+            base = r->base;
+        if (r->base + r->size > end)
+            end = r->base + r->size;
+    }
+    if (i == j) /* 没有可以合并的区间，插入一项 */
+    {
+        memblock_insert_region(type, i, base, end - base);
+        return;
+    }
+    /* 第i到第j-1项合并为第i项 */
+    while (j > i + 1)
+        memblock_remove_region(type, --j);
+    type->regions[i].base = base;
+    type->regions[i].size = end - base;
+}
+
+/* 把[base, base + size)从区间表中去掉，被它从中间截断的区间拆成两个。参数：
+type：区间表
+base：起始物理地址
+size：字节数 */
+static void __init memblock_remove_range(struct memblock_type *type, unsigned long base, unsigned long size)
+{
+    unsigned long end = base + size, rend, i = 0;
+    struct memblock_region *r;
+
+    while (i < type->cnt)
+    {
+        r = &type->regions[i];
+        rend = r->base + r->size;
+        if (rend <= base) /* 在要去掉的区间之前 */
+        {
+            i++;
+            continue;
+        }
+        if (r->base >= end) /* 在要去掉的区间之后，后面的都不用看了 */
+            break;
+        if (r->base < base && rend > end) /* 要去掉的在区间中间，拆成两段 */
+        {
+            r->size = base - r->base;
+            memblock_insert_region(type, i + 1, end, rend - end);
+            break;
+        }
+        if (r->base < base) /* 去掉区间的尾部 */
+        {
+            r->size = base - r->base;
+            i++;
+        }
+        else if (rend > end) /* 去掉区间的头部 */
+        {
+            r->base = end;
+            r->size = rend - end;
+            i++;
+        }
+        else /* 整个区间都去掉 */
+            memblock_remove_region(type, i);
+    }
+}
+
+/* 登记一段可用内存，setup_arch用e820中的每一段RAM调用它 */
+void __init memblock_add(unsigned long base, unsigned long size)
+{
+    memblock_add_range(&memblock.memory, base, size);
+}
+
+/* 把一段内存标记为已占用 */
+void __init memblock_reserve(unsigned long base, unsigned long size)
+{
+    memblock_add_range(&memblock.reserved, base, size);
+}
+
+/* 把一段已占用的内存还回去 */
+void __init memblock_free(unsigned long base, unsigned long size)
+{
+    memblock_remove_range(&memblock.reserved, base, size);
+}
+
+/* 取下一段空闲内存，即memory中没有被reserved覆盖的部分，按地址从低到高返回。
+游标*idx的低16位是memory的表项下标，高16位是reserved中空隙的下标：第k个空隙是第k-1个与第k个已占用区间之间的内存，
+第0个空隙从0开始，最后一个空隙一直到地址空间末尾。两张表都是有序的，每调用一次两个下标至少有一个前进，
+所以遍历一遍的代价与两张表的项数之和成正比。参数：
+idx：游标，第一次调用前置0
+start、end：返回空闲内存[*start, *end)
+返回：1表示找到，0表示遍历结束 */
+int __defermem_init memblock_next_free_range(unsigned long *idx, unsigned long *start, unsigned long *end)
+{
+    struct memblock_type *mem = &memblock.memory, *rsv = &memblock.reserved;
+    unsigned long mi = *idx & 0xffff, ri = *idx >> 16;
+    unsigned long m_start, m_end, r_start, r_end;
+
+    for (; mi < mem->cnt; mi++)
+    {
+        m_start = mem->regions[mi].base;
+        m_end = m_start + mem->regions[mi].size;
+        for (; ri < rsv->cnt + 1; ri++)
+        {
+            r_start = ri ? rsv->regions[ri - 1].base + rsv->regions[ri - 1].size : 0;
+            r_end = ri < rsv->cnt ? rsv->regions[ri].base : ~0UL;
+            if (r_start >= m_end) /* 这个空隙已经在可用内存之后，换下一段可用内存 */
+                break;
+            if (m_start < r_end) /* 空隙与可用内存有交集 */
+            {
+                *start = m_start > r_start ? m_start : r_start;
+                *end = m_end < r_end ? m_end : r_end;
+                /* 谁先结束谁前进 */
+                if (m_end <= r_end)
+                    mi++;
+                else
+                    ri++;
+                *idx = mi | (ri << 16);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* 在[start, end)内找一段size字节、按align对齐的空闲内存，从高地址往低地址找，
+这样低端的内存（比如DMA区域）留到最后才会被用掉。end不会超过memblock.current_limit。参数：
+start、end：查找的物理地址范围
+size：字节数
+align：对齐，必须是2的幂
+pad：返回这段内存之后到所在空闲区间结尾之间因为对齐空出来的字节数
+返回：找到的物理地址，找不到返回0（0页总是被保留的，不会被分配出去） */
+unsigned long __init memblock_find_in_range(unsigned long start, unsigned long end, unsigned long size,
+                                            unsigned long align, unsigned long *pad)
+{
+    unsigned long i, fstart, fend, cand, found = 0;
+
+    if (end > memblock.current_limit)
+        end = memblock.current_limit;
+    for_each_free_mem_range(i, &fstart, &fend)
+    {
+        if (fstart >= end)
+            break;
+        if (fstart < start)
+            fstart = start;
+        if (fend > end)
+            fend = end;
+        if (fend <= fstart || fend - fstart < size)
+            continue;
+        cand = (fend - size) & ~(align - 1); /* 空闲区间内最高的对齐地址 */
+        if (cand < fstart)
+            continue;
+        /* 空闲区间是从低到高返回的，最后一个放得下的就是最高的 */
+        found = cand;
+        *pad = fend - cand - size;
+    }
+    return found;
+}
+
+/* 设置可分配的最高地址（不含） */
+void __init memblock_set_current_limit(unsigned long limit)
+{
+    memblock.current_limit = limit;
+}
+
+/* 打印两张区间表 */
+void __init memblock_dump(void)
+{
+    unsigned long i;
+
+    printk("memblock: %lu memory regions, %lu reserved regions\n", memblock.memory.cnt, memblock.reserved.cnt);
+    for (i = 0; i < memblock.memory.cnt; i++)
+        printk("memblock: memory   [%08lx-%08lx]\n", memblock.memory.regions[i].base,
+               memblock.memory.regions[i].base + memblock.memory.regions[i].size - 1);
+    for (i = 0; i < memblock.reserved.cnt; i++)
+        printk("memblock: reserved [%08lx-%08lx]\n", memblock.reserved.regions[i].base,
+               memblock.reserved.regions[i].base + memblock.reserved.regions[i].size - 1);
+}
+
+#endif /* CONFIG_NO_BOOTMEM */
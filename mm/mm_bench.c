@@ -0,0 +1,589 @@
+/* 内存分配器的启动期压力测试与性能基准。
+Linux2.4没有这样的东西，真正的内核可以借助用户态程序来测试，我们的内核只有start_kernel这一条执行流，
+所以在内存初始化完成之后，直接在内核里用一个伪随机序列反复分配、释放，
+每次操作都用时间戳计数器计时，结束时把所有东西还回去，检查空闲页数是否复原，并打印各阶延迟分布与吞吐量。
+整个文件只在定义了CONFIG_MM_BENCH时才参与编译 */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/init.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/mm_bench.h>
+#include <linux/bootmem.h>
+#include <asm-i386/div64.h>
+#include <asm-i386/dma.h>
+
+#ifdef CONFIG_MM_BENCH
+
+/* 伙伴系统压力测试同时持有的内存块数量 */
+#define BENCH_SLOTS 256
+
+/* 伙伴系统压力测试的操作次数 */
+#define BENCH_OPS 20000
+
+/* 压力测试分配的最大阶，阶数按几何分布选取，阶越高越少见 */
+#define BENCH_MAX_ORDER 5
+
+/* 写在每个分配出去的页面开头的魔数，用于发现同一块内存被分配了两次 */
+#define BENCH_MAGIC 0x5a5a0000UL
+
+/* 伪随机数发生器的状态，固定种子让每次启动的操作序列相同，便于比较前后两次改动的结果 */
+static unsigned long bench_seed = 2463534242UL;
+
+/* xorshift32伪随机数发生器 */
+unsigned long bench_random(void)
+{
+    unsigned long x = bench_seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bench_seed = x;
+    return x;
+}
+
+/* 清空一个延迟直方图 */
+void bench_hist_init(struct bench_hist *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+/* 把一次耗时cycles个周期的操作记入直方图 */
+void bench_hist_add(struct bench_hist *hist, cycles_t cycles)
+{
+    unsigned long c = (unsigned long)cycles;
+    int b = 0;
+
+    if (cycles >> 32) /* 超过32位的耗时一律记入最后一个桶 */
+        b = BENCH_HIST_BUCKETS - 1;
+    else
+        while (c >>= 1)
+            b++;
+    hist->bucket[b]++;
+    hist->nr++;
+    hist->total += cycles;
+    if (cycles > hist->max)
+        hist->max = cycles;
+}
+
+/* 返回直方图中第percent百分位所在桶的上界（周期数） */
+static unsigned long bench_hist_percentile(struct bench_hist *hist, unsigned long percent)
+{
+    unsigned long want = (hist->nr * percent + 99) / 100; /* 向上取整，至少要覆盖这么多次操作 */
+    unsigned long sum = 0;
+    int b;
+
+    for (b = 0; b < BENCH_HIST_BUCKETS - 1; b++)
+    {
+        sum += hist->bucket[b];
+        if (sum >= want)
+            break;
+    }
+    return (2UL << b) - 1;
+}
+
+/* 打印一个直方图的汇总：次数、平均、p50、p99、最大耗时，以及按cpu主频折算的每秒操作数 */
+void bench_hist_show(const char *name, struct bench_hist *hist)
+{
+    cycles_t avg;
+    unsigned long long ops;
+
+    if (!hist->nr)
+        return;
+    avg = hist->total;
+    do_div(avg, hist->nr);
+    if (!avg)
+        avg = 1;
+
+    printk("%-14s %7lu ops  avg %6lu  p50 <%6lu  p99 <%7lu  max %8lu cycles",
+           name, hist->nr, (unsigned long)avg,
+           bench_hist_percentile(hist, 50), bench_hist_percentile(hist, 99),
+           (unsigned long)hist->max);
+    if (cpu_khz) /* 时间戳计数器校准失败时只能给出周期数 */
+    {
+        ops = (unsigned long long)cpu_khz * 1000;
+        do_div(ops, (unsigned long)avg);
+        printk("  %lu ops/s", (unsigned long)ops);
+    }
+    printk("\n");
+}
+
+/* 伙伴系统压力测试中的一个槽位，记录当前持有的内存块 */
+struct bench_slot
+{
+    struct page *page;  /* 持有的内存块的首页，NULL表示空槽 */
+    unsigned int order; /* 内存块的阶 */
+};
+
+static struct bench_slot bench_slots[BENCH_SLOTS] __initdata;
+static struct bench_hist bench_alloc_hist[BENCH_MAX_ORDER + 1] __initdata;
+static struct bench_hist bench_free_hist[BENCH_MAX_ORDER + 1] __initdata;
+
+/* 在内存块的每一页开头写入槽号，以便释放时检查是否有别的槽位拿到了同一块内存 */
+static void __init bench_fill(struct bench_slot *slot, unsigned long idx)
+{
+    unsigned long i;
+
+    for (i = 0; i < (1UL << slot->order); i++)
+        *(unsigned long *)page_address(slot->page + i) = BENCH_MAGIC | idx;
+}
+
+/* 检查内存块每一页开头的槽号，返回被破坏的页数 */
+static unsigned long __init bench_check(struct bench_slot *slot, unsigned long idx)
+{
+    unsigned long i, bad = 0;
+
+    for (i = 0; i < (1UL << slot->order); i++)
+        if (*(unsigned long *)page_address(slot->page + i) != (BENCH_MAGIC | idx))
+            bad++;
+    return bad;
+}
+
+/* 伙伴系统随机压力测试：每次随机挑一个槽位，空槽就按几何分布选一个阶分配，满槽就释放，
+这样持有的内存块数量会在BENCH_SLOTS的一半附近波动，不断地拆分与合并伙伴 */
+static void __init bench_buddy(void)
+{
+    unsigned long free_before, free_after;
+    unsigned long fails = 0, corrupt = 0;
+    unsigned long op, idx;
+    unsigned int order;
+    int gfp;
+    struct bench_slot *slot;
+    cycles_t t0, t1;
+
+    for (order = 0; order <= BENCH_MAX_ORDER; order++)
+    {
+        bench_hist_init(&bench_alloc_hist[order]);
+        bench_hist_init(&bench_free_hist[order]);
+    }
+    free_before = nr_free_pages();
+
+    for (op = 0; op < BENCH_OPS; op++)
+    {
+        idx = bench_random() % BENCH_SLOTS;
+        slot = &bench_slots[idx];
+        if (slot->page)
+        {
+            corrupt += bench_check(slot, idx);
+            t0 = get_cycles();
+            __free_pages(slot->page, slot->order);
+            t1 = get_cycles();
+            bench_hist_add(&bench_free_hist[slot->order], t1 - t0);
+            slot->page = NULL;
+            continue;
+        }
+
+        order = 0;
+        while (order < BENCH_MAX_ORDER && (bench_random() & 1)) /* 每升一阶概率减半 */
+            order++;
+        /* 四分之一的槽位模拟内核自己不可移动的分配，其余模拟可移动的用户页面，
+        两种类型混在一起反复分配释放，检验按迁移类型分组后高阶空闲块能否保留下来 */
+        gfp = (idx & 3) ? GFP_KERNEL | __GFP_MOVABLE : GFP_KERNEL;
+        t0 = get_cycles();
+        slot->page = alloc_pages(gfp, order);
+        t1 = get_cycles();
+        if (!slot->page)
+        {
+            fails++;
+            continue;
+        }
+        bench_hist_add(&bench_alloc_hist[order], t1 - t0);
+        slot->order = order;
+        bench_fill(slot, idx);
+    }
+
+    /* 归还所有还持有的内存块 */
+    for (idx = 0; idx < BENCH_SLOTS; idx++)
+    {
+        slot = &bench_slots[idx];
+        if (!slot->page)
+            continue;
+        corrupt += bench_check(slot, idx);
+        __free_pages(slot->page, slot->order);
+        slot->page = NULL;
+    }
+    free_after = nr_free_pages();
+
+    printk("buddy: %lu ops, %lu alloc failures, %lu corrupted pages, free pages %lu -> %lu\n",
+           (unsigned long)BENCH_OPS, fails, corrupt, free_before, free_after);
+    for (order = 0; order <= BENCH_MAX_ORDER; order++)
+    {
+        char alloc_name[] = "alloc order ?";
+        char free_name[] = "free  order ?";
+
+        alloc_name[12] = free_name[12] = '0' + order;
+        bench_hist_show(alloc_name, &bench_alloc_hist[order]);
+        bench_hist_show(free_name, &bench_free_hist[order]);
+    }
+    if (corrupt || free_after != free_before)
+        printk("buddy: FAILED\n");
+    show_buddyinfo();
+}
+
+/* slab压力测试使用的对象大小 */
+#define BENCH_SLAB_OBJSIZE 128
+
+static void *bench_objs[BENCH_SLOTS] __initdata;
+static struct bench_hist bench_slab_alloc_hist __initdata;
+static struct bench_hist bench_slab_free_hist __initdata;
+
+/* slab随机压力测试：与伙伴系统的测试一样随机挑槽位分配或释放对象，对象开头写入槽号，
+结束时销毁缓存池，检查所有slab页面都还给了伙伴系统 */
+static void __init bench_slab(void)
+{
+    unsigned long free_before, free_after;
+    unsigned long fails = 0, corrupt = 0;
+    unsigned long op, idx;
+    kmem_cache_t *cachep;
+    cycles_t t0, t1;
+
+    bench_hist_init(&bench_slab_alloc_hist);
+    bench_hist_init(&bench_slab_free_hist);
+    free_before = nr_free_pages();
+    cachep = kmem_cache_create("bench", BENCH_SLAB_OBJSIZE, 0, SLAB_HWCACHE_ALIGN, NULL, NULL);
+    if (!cachep)
+    {
+        printk("slab: can't create cache\n");
+        return;
+    }
+
+    for (op = 0; op < BENCH_OPS; op++)
+    {
+        idx = bench_random() % BENCH_SLOTS;
+        if (bench_objs[idx])
+        {
+            if (*(unsigned long *)bench_objs[idx] != (BENCH_MAGIC | idx))
+                corrupt++;
+            t0 = get_cycles();
+            kmem_cache_free(cachep, bench_objs[idx]);
+            t1 = get_cycles();
+            bench_hist_add(&bench_slab_free_hist, t1 - t0);
+            bench_objs[idx] = NULL;
+            continue;
+        }
+
+        t0 = get_cycles();
+        bench_objs[idx] = kmem_cache_alloc(cachep, SLAB_KERNEL);
+        t1 = get_cycles();
+        if (!bench_objs[idx])
+        {
+            fails++;
+            continue;
+        }
+        bench_hist_add(&bench_slab_alloc_hist, t1 - t0);
+        *(unsigned long *)bench_objs[idx] = BENCH_MAGIC | idx;
+    }
+
+    for (idx = 0; idx < BENCH_SLOTS; idx++)
+    {
+        if (!bench_objs[idx])
+            continue;
+        if (*(unsigned long *)bench_objs[idx] != (BENCH_MAGIC | idx))
+            corrupt++;
+        kmem_cache_free(cachep, bench_objs[idx]);
+        bench_objs[idx] = NULL;
+    }
+    if (kmem_cache_destroy(cachep))
+        corrupt++;
+    free_after = nr_free_pages();
+
+    printk("slab: %lu ops on %d-byte objects, %lu alloc failures, %lu corrupted objects, free pages %lu -> %lu\n",
+           (unsigned long)BENCH_OPS, BENCH_SLAB_OBJSIZE, fails, corrupt, free_before, free_after);
+    bench_hist_show("slab alloc", &bench_slab_alloc_hist);
+    bench_hist_show("slab free", &bench_slab_free_hist);
+    if (corrupt || free_after != free_before)
+        printk("slab: FAILED\n");
+}
+
+/* 构造函数基准测试使用的对象，模拟内核里带链表头和一张表的结构体，初始化它要写满整个对象 */
+struct bench_ctor_obj
+{
+    struct list_head list;     /* 对象所在的链表 */
+    unsigned long owner;       /* 持有者，构造好的状态下为0 */
+    unsigned long table[61];   /* 构造好的状态下全为0 */
+};
+
+/* 构造函数测试的缓存池的构造函数，把对象初始化成构造好的状态 */
+static void __init bench_ctor_init(void *objp, kmem_cache_t *cachep, unsigned long flags)
+{
+    struct bench_ctor_obj *obj = objp;
+
+    (void)cachep;
+    (void)flags;
+    INIT_LIST_HEAD(&obj->list);
+    obj->owner = 0;
+    memset(obj->table, 0, sizeof(obj->table));
+}
+
+static struct bench_hist bench_ctor_hist[2] __initdata;
+
+/* 用同一个随机序列分别跑一次不带构造函数和带构造函数的缓存池，返回是否发现了损坏的对象，参数：
+ctor：是否使用构造函数。不用时每次分配后由调用者初始化整个对象；
+用时分配到的对象已经是构造好的状态，调用者只在释放前把自己改动过的字段恢复原样 */
+static int __init bench_ctor_run(int ctor)
+{
+    struct bench_ctor_obj *obj;
+    struct bench_hist *hist = &bench_ctor_hist[ctor];
+    unsigned long op, idx, corrupt = 0;
+    kmem_cache_t *cachep;
+    cycles_t t0, t1;
+
+    bench_hist_init(hist);
+    cachep = kmem_cache_create(ctor ? "bench-ctor" : "bench-noctor", sizeof(struct bench_ctor_obj), 0,
+                               SLAB_HWCACHE_ALIGN, ctor ? bench_ctor_init : NULL, NULL);
+    if (!cachep)
+    {
+        printk("ctor: can't create cache\n");
+        return 1;
+    }
+
+    for (op = 0; op < BENCH_OPS; op++)
+    {
+        idx = bench_random() % BENCH_SLOTS;
+        obj = bench_objs[idx];
+        if (obj)
+        {
+            if (obj->owner != idx + 1 || obj->list.next != &obj->list || obj->table[60])
+                corrupt++;
+            if (ctor) /* 交还前恢复成构造好的状态 */
+                obj->owner = 0;
+            kmem_cache_free(cachep, obj);
+            bench_objs[idx] = NULL;
+            continue;
+        }
+
+        /* 计时的是调用者拿到一个可以直接使用的对象所花的周期：分配加上初始化 */
+        t0 = get_cycles();
+        obj = kmem_cache_alloc(cachep, SLAB_KERNEL);
+        if (obj && !ctor)
+            bench_ctor_init(obj, cachep, 0);
+        t1 = get_cycles();
+        if (!obj)
+            continue;
+        bench_hist_add(hist, t1 - t0);
+        if (obj->owner) /* 构造好的对象必须是干净的 */
+            corrupt++;
+        obj->owner = idx + 1;
+        bench_objs[idx] = obj;
+    }
+
+    for (idx = 0; idx < BENCH_SLOTS; idx++)
+    {
+        obj = bench_objs[idx];
+        if (!obj)
+            continue;
+        if (ctor)
+            obj->owner = 0;
+        kmem_cache_free(cachep, obj);
+        bench_objs[idx] = NULL;
+    }
+    if (kmem_cache_destroy(cachep))
+        corrupt++;
+    return corrupt != 0;
+}
+
+/* 构造函数基准测试：对象在slab增长时构造一次，之后的每次分配都省掉了初始化，
+打印两种做法每次拿到可用对象的平均周期数与每次分配省下的周期数 */
+static void __init bench_ctor(void)
+{
+    unsigned long seed = bench_seed;
+    unsigned long free_before, free_after;
+    cycles_t avg[2];
+    int bad, i;
+
+    free_before = nr_free_pages();
+    bad = bench_ctor_run(0);
+    bench_seed = seed; /* 两次运行使用完全相同的操作序列 */
+    bad |= bench_ctor_run(1);
+    free_after = nr_free_pages();
+
+    for (i = 0; i < 2; i++)
+    {
+        avg[i] = bench_ctor_hist[i].total;
+        if (bench_ctor_hist[i].nr)
+            do_div(avg[i], bench_ctor_hist[i].nr);
+    }
+    printk("ctor: %lu ops on %u-byte objects, free pages %lu -> %lu\n",
+           (unsigned long)BENCH_OPS, (unsigned int)sizeof(struct bench_ctor_obj), free_before, free_after);
+    bench_hist_show("alloc+init", &bench_ctor_hist[0]);
+    bench_hist_show("alloc ctor", &bench_ctor_hist[1]);
+    printk("ctor: %ld cycles saved per alloc\n", (long)(avg[0] - avg[1]));
+    if (bad || free_after != free_before)
+        printk("ctor: FAILED\n");
+}
+
+/* 着色基准测试的对象大小：一页放4个对象，放下slab管理结构之后末尾还剩192字节用来着色 */
+#define BENCH_COLOUR_OBJSIZE 960
+
+/* 着色基准测试反复遍历的对象个数，它们只占很少几个缓存组时远远超过缓存的组相联度，错开之后则能全部留在L1中 */
+#define BENCH_COLOUR_OBJS 128
+
+/* 着色基准测试遍历对象的趟数 */
+#define BENCH_COLOUR_PASSES 200
+
+/* 用给定的着色偏移量创建缓存池，分配BENCH_COLOUR_OBJS个对象，每个对象的第一个字指向下一个对象，
+沿着这条链反复走。每次读取都依赖上一次读到的地址，测到的是访存延迟，而不是cpu同时发出多个读取的吞吐，参数：
+name：缓存池的名字
+offset：着色偏移量，等于对象大小时slab末尾放不下第二种颜色，相当于关闭着色
+返回：平均每次读取的周期数，出错返回0 */
+static unsigned long __init bench_colour_run(const char *name, size_t offset)
+{
+    kmem_cache_t *cachep;
+    unsigned long pass;
+    void *p;
+    cycles_t t0, t1;
+    int n;
+
+    cachep = kmem_cache_create(name, BENCH_COLOUR_OBJSIZE, offset, 0, NULL, NULL);
+    if (!cachep)
+    {
+        printk("colour: can't create cache\n");
+        return 0;
+    }
+    for (n = 0; n < BENCH_COLOUR_OBJS; n++)
+        if (!(bench_objs[n] = kmem_cache_alloc(cachep, SLAB_KERNEL)))
+            break;
+    if (n < BENCH_COLOUR_OBJS)
+    {
+        printk("colour: out of memory\n");
+        t1 = t0 = 0;
+        goto out;
+    }
+    for (n = 0; n < BENCH_COLOUR_OBJS; n++) /* 串成一个环 */
+        *(void **)bench_objs[n] = bench_objs[(n + 1) % BENCH_COLOUR_OBJS];
+
+    p = bench_objs[0];
+    for (n = 0; n < BENCH_COLOUR_OBJS; n++) /* 先走一圈，把对象读进缓存 */
+        p = *(void *volatile *)p;
+    t0 = get_cycles();
+    for (pass = 0; pass < BENCH_COLOUR_PASSES * BENCH_COLOUR_OBJS; pass++)
+        p = *(void *volatile *)p;
+    t1 = get_cycles();
+
+out:
+    for (n = 0; n < BENCH_COLOUR_OBJS && bench_objs[n]; n++)
+    {
+        kmem_cache_free(cachep, bench_objs[n]);
+        bench_objs[n] = NULL;
+    }
+    kmem_cache_destroy(cachep);
+
+    t1 -= t0;
+    do_div(t1, BENCH_COLOUR_PASSES * BENCH_COLOUR_OBJS);
+    return (unsigned long)t1;
+}
+
+/* 着色基准测试：同样的对象分别在关闭着色、按编译时的L1_CACHE_BYTES着色、按检测到的缓存行大小着色的缓存池中，
+反复读取每个对象的开头。不着色时所有slab中相同序号的对象映射到同一个缓存组，超过组相联度就互相挤出缓存 */
+static void __init bench_colour(void)
+{
+    unsigned long off, l1, line;
+
+    off = bench_colour_run("bench-nocolour", BENCH_COLOUR_OBJSIZE);
+    l1 = bench_colour_run("bench-colour-l1", L1_CACHE_BYTES);
+    line = bench_colour_run("bench-colour", 0);
+    printk("colour: %d objects of %d bytes, %d-byte cache lines, cycles/access: "
+           "no colour %lu, %d-byte step %lu, %d-byte step %lu\n",
+           BENCH_COLOUR_OBJS, BENCH_COLOUR_OBJSIZE, cache_line_size(),
+           off, L1_CACHE_BYTES, l1, cache_line_size(), line);
+}
+
+/* 引导内存查找基准测试模拟的内存页面数：4GB，位图1M位，正好128KB */
+#define BENCH_BOOTMEM_PAGES (1UL << (32 - PAGE_SHIFT))
+
+/* 模拟的位图中开头被占用的页面数：内核映像、BIOS等占用的低4MB */
+#define BENCH_BOOTMEM_RESERVED 1024
+
+/* 从16MB开始的这么多个页面中，每BENCH_BOOTMEM_GAP个空闲页面后面有一个被占用的页面（页表、e820中的洞等），
+这样零碎的空闲区段放不下大块分配，对逐位检查最不利 */
+#define BENCH_BOOTMEM_FRAG_PAGES 65536
+#define BENCH_BOOTMEM_GAP 1024
+
+/* 按__alloc_bootmem_core的方式查找：先从preferred开始，找不到再从0开始，参数：
+bitwise：是否使用逐位检查的旧方法
+map、preferred、areasize：同bootmem_find_free
+cycles：累加这次查找的耗时
+返回：找到的起始页面 */
+static unsigned long __init bench_bootmem_find(int bitwise, unsigned long *map, unsigned long preferred,
+                                               unsigned long areasize, cycles_t *cycles)
+{
+    unsigned long (*find)(unsigned long *, unsigned long, unsigned long, unsigned long, unsigned long);
+    unsigned long start;
+    cycles_t t0;
+
+    find = bitwise ? bootmem_find_free_bitwise : bootmem_find_free;
+    t0 = get_cycles();
+    start = find(map, BENCH_BOOTMEM_PAGES, preferred, areasize, 1);
+    if (start >= BENCH_BOOTMEM_PAGES && preferred)
+        start = find(map, BENCH_BOOTMEM_PAGES, 0, areasize, 1);
+    *cycles += get_cycles() - t0;
+    return start;
+}
+
+/* 引导内存查找基准测试：在一个模拟的、前部零碎的4GB引导内存位图上，依次分配mem_map与伙伴系统10个阶的位图，
+与free_area_init_core中的请求相同（对齐SMP_CACHE_BYTES，从16MB开始找），分别用逐位检查与按long检查的方法查找，
+检查两者找到的位置相同，打印各自的耗时 */
+static void __init bench_bootmem(void)
+{
+    unsigned long *map;
+    unsigned long i, req, areasize, old_start, new_start;
+    unsigned long preferred = __pa(MAX_DMA_ADDRESS) >> PAGE_SHIFT;
+    cycles_t old_total = 0, new_total = 0, old_cycles, new_cycles;
+    int bad = 0;
+
+    map = kmalloc(BENCH_BOOTMEM_PAGES / 8, GFP_KERNEL);
+    if (!map)
+    {
+        printk("bootmem: can't allocate bitmap\n");
+        return;
+    }
+    memset(map, 0, BENCH_BOOTMEM_PAGES / 8);
+    bitmap_set(map, 0, BENCH_BOOTMEM_RESERVED);
+    for (i = preferred; i < preferred + BENCH_BOOTMEM_FRAG_PAGES; i += BENCH_BOOTMEM_GAP + 1)
+        set_bit(i, map);
+
+    for (req = 0; req <= MAX_ORDER; req++)
+    {
+        /* 第0个请求是mem_map，之后是第req-1阶的位图 */
+        if (!req)
+            areasize = (BENCH_BOOTMEM_PAGES + 1) * sizeof(struct page);
+        else
+            areasize = ((BENCH_BOOTMEM_PAGES >> (req - 1)) + 7) >> 3;
+        areasize = (areasize + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+        old_cycles = new_cycles = 0;
+        old_start = bench_bootmem_find(1, map, preferred, areasize, &old_cycles);
+        new_start = bench_bootmem_find(0, map, preferred, areasize, &new_cycles);
+        old_total += old_cycles;
+        new_total += new_cycles;
+        if (old_start != new_start || new_start >= BENCH_BOOTMEM_PAGES)
+        {
+            bad = 1;
+            break;
+        }
+        printk("bootmem: %-9s %5lu pages at pfn %7lu: bitwise %10lu, word-at-a-time %7lu cycles\n",
+               req ? "bitmap" : "mem_map", areasize, new_start, (unsigned long)old_cycles, (unsigned long)new_cycles);
+        bitmap_set(map, new_start, areasize);
+    }
+    kfree(map);
+
+    printk("bootmem: total bitwise %lu, word-at-a-time %lu cycles\n",
+           (unsigned long)old_total, (unsigned long)new_total);
+    if (bad)
+        printk("bootmem: FAILED\n");
+}
+
+/* 内存分配器基准测试的入口，在mem_init之后调用 */
+void __init mm_bench(void)
+{
+    printk("Memory allocator benchmark (cpu %lu kHz)\n", cpu_khz);
+    bench_buddy();
+    bench_slab();
+    bench_ctor();
+    bench_colour();
+    bench_bootmem();
+}
+
+#endif /* CONFIG_MM_BENCH */
@@ -3,6 +3,9 @@
 #include <linux/swapctl.h>
 #include <linux/interrupt.h>
 #include <linux/bootmem.h>
+#include <linux/slab.h>
+#include <asm-i386/timex.h>
+#include <asm-i386/div64.h>
 
 /* 从struct page形成的链表中删除一个page */
 #define memlist_del list_del
@@ -10,6 +13,12 @@
 /* 向struct page形成的链表中加入一个page */
 #define memlist_add_head list_add
 
+/* 得到struct page形成的链表中的下一个节点 */
+#define memlist_next(x) ((x)->next)
+
+/* 通过链表节点得到包含它的结构体（一般就是struct page） */
+#define memlist_entry list_entry
+
 /* 抽象每个内存节点的pg_data_t结构体形成的单链表 */
 pg_data_t *pgdat_list;
 
@@ -108,6 +117,77 @@ static inline void build_zonelists(pg_data_t *pgdat)
     }
 }
 
+/* 按zone编号找到zone，页描述符的flags中只记录zone的编号，见page_zone */
+zone_t *zone_table[MAX_NR_ZONES];
+
+/* 平均每多少个页面共用一个等待队列 */
+#define PAGES_PER_WAITQUEUE 256
+
+/* 根据zone的页面数计算等待队列哈希表的大小：每PAGES_PER_WAITQUEUE个页面一个，
+向上取整到2的幂，最多4096个。同时等待页面的进程数取决于进程数而不是内存大小，所以不需要更大的表。参数：
+pages：zone的页面数 */
+static inline unsigned long wait_table_size(unsigned long pages)
+{
+    unsigned long size = 1;
+
+    pages /= PAGES_PER_WAITQUEUE;
+    while (size < pages)
+        size <<= 1;
+    if (size > 4096UL)
+        size = 4096UL;
+    return size;
+}
+
+/* 返回2的幂size是2的几次方 */
+static inline unsigned long wait_table_bits(unsigned long size)
+{
+    unsigned long bits = 0;
+
+    while ((1UL << bits) < size)
+        bits++;
+    return bits;
+}
+
+/* 启动时同步初始化页描述符所花的时钟周期数，cpu主频在time_init中才校准，所以先记下周期数，之后再换算 */
+static cycles_t memmap_init_cycles;
+
+/* 初始化节点中第start到第end-1个页面的页描述符，调用时这些页面所在zone的范围必须已经确定。
+Linux2.4在free_area_init_core中分两次遍历所有页面：第一次设置引用计数、保留标志、等待队列与链表，
+第二次按zone设置所属zone与虚拟地址。这里按zone一次完成，每个页描述符只被访问一次，
+而且页描述符中已经没有等待队列与虚拟地址，所属zone也只是flags中的两位。参数：
+pgdat：页面所在的内存节点
+start：第一个页面在节点中的页号
+end：最后一个页面之后的页号 */
+void __defermem_init memmap_init_range(pg_data_t *pgdat, unsigned long start, unsigned long end)
+{
+    zone_t *zone;
+
+    for (zone = pgdat->node_zones; zone < pgdat->node_zones + MAX_NR_ZONES; zone++)
+    {
+        unsigned long zstart = zone->zone_start_mapnr - pgdat->node_start_mapnr; /* zone在节点中的起始页号 */
+        unsigned long zend = zstart + zone->size;
+        unsigned long i;
+
+        if (!zone->size)
+            continue;
+        if (zstart < start) /* 只处理[start, end)与zone的交集 */
+            zstart = start;
+        if (zend > end)
+            zend = end;
+        for (i = zstart; i < zend; i++)
+        {
+            struct page *page = pgdat->node_mem_map + i;
+
+            set_page_count(page, 0); /* 将页面的引用计数设置为0 */
+            /* 将页面标记为保留， 保留的页面不会被常规的内存分配器分配，
+            直到引导内存分配器确认它空闲后才清除 */
+            SetPageReserved(page);
+            memlist_init(&page->list);                       /* 初始化页面的链表头 */
+            set_page_zone(page, zone - pgdat->node_zones);   /* 每个页面都知道它属于哪个内存区域 */
+        }
+    }
+}
+
 /* 函数的核心目的是为特定的节点初始化其内存区域，
 完成工作：1、为内存节点所有zone创建一个page数组，并初始化每个struct page；2、设定pglist相关成员；
 3、设定pglist内node_zones数组内每个zone结构体；4、初始化管理整个系统剩余空间的freepages结构体；
@@ -126,11 +206,11 @@ void __init free_area_init_core(int nid, pg_data_t *pgdat, struct page **gmap,
                                 unsigned long *zones_size, unsigned long zone_start_paddr,
                                 unsigned long *zholes_size, struct page *lmem_map)
 {
-    struct page *p;                                   /* 用于后续操作页面 */
     unsigned long i, j;                               /* 用于循环迭代 */
     unsigned long map_size;                           /* 用于存储内存映射所需的大小 */
     unsigned long totalpages, offset, realtotalpages; /* 内存节点所有区域的总页数、偏移量、实际总页数 */
     unsigned int cumulative = 0;                      /* cumulative 用于记录处理过的所有区域的总页数 */
+    cycles_t t0;                                      /* 页描述符初始化的开始时间 */
 
     totalpages = 0;                    /* 初始化总页数为 0 */
     for (i = 0; i < MAX_NR_ZONES; i++) /* 遍历区域大小数组 */
@@ -168,25 +248,15 @@ void __init free_area_init_core(int nid, pg_data_t *pgdat, struct page **gmap,
     pgdat->node_start_paddr = zone_start_paddr;     /* 设置当前节点的起始物理地址 */
     pgdat->node_start_mapnr = (lmem_map - mem_map); /* 计算 lmem_map 相对于全局内存映射 mem_map 的偏移量 */
 
-    for (p = lmem_map; p < lmem_map + totalpages; p++) /* 遍历本节点的所有内存页面 */
-    {
-        set_page_count(p, 0); /* 将页面 p 的引用计数设置为0 */
-        /* 将页面 p 标记为保留， 保留的页面不会被常规的内存分配器分配出去，
-        这通常用于保护内核代码和数据不被意外覆盖或用于其他目的 */
-        SetPageReserved(p);
-        /* 调用初始化页面 p 的等待队列头。等待队列用于在内核中管理线程或进程的睡眠和唤醒。
-        通过初始化等待队列，页面可以被用于各种同步机制 */
-        init_waitqueue_head(&p->wait);
-        /* 初始化页面 p 的链表头 */
-        memlist_init(&p->list);
-    }
-
     offset = lmem_map - mem_map;       /* 计算从全局内存映射 (mem_map) 到局部内存映射 (lmem_map) 的偏移量 */
     for (j = 0; j < MAX_NR_ZONES; j++) /* 历节点上的所有内存区域 */
     {
         zone_t *zone = pgdat->node_zones + j; /* zone 指针指向当前处理的内存区域 */
         unsigned long mask;
         unsigned long size, realsize; /* 记录zone的大小、真实大小 */
+        unsigned long batch;          /* 冷热页缓存每批与伙伴系统之间搬运的页面数 */
+        unsigned long nr_pageblocks;  /* zone中pageblock的个数 */
+        int cpu;
 
         realsize = size = zones_size[j]; /* 设置当前区域的大小 (size) 和实际大小 (realsize)。这两个值初始相同 */
         if (zholes_size)                 /* 如果 zholes_size（空洞大小数组）存在 */
@@ -195,12 +265,44 @@ void __init free_area_init_core(int nid, pg_data_t *pgdat, struct page **gmap,
         printk("zone(%lu): %lu pages.\n", j, size); /* 打印区域信息 */
         zone->size = size;                          /* 设置区域的大小 */
         zone->name = zone_names[j];                 /* 设置区域的名称 */
+        zone_table[j] = zone;                       /* 页描述符通过flags中的zone编号找到zone */
         zone->lock = SPIN_LOCK_UNLOCKED;            /* 初始化区域的自旋锁为解锁状态 */
         zone->zone_pgdat = pgdat;                   /* 设置区域的页面数据指针指向管理本节点内存的pgdata */
         zone->free_pages = 0;                       /* 初始化空闲页计数 */
         zone->inactive_clean_pages = 0;             /* 初始化非活动干净页计数 */
         zone->inactive_dirty_pages = 0;             /* 初始化非活动脏页计数 */
         memlist_init(&zone->inactive_clean_list);   /* 初始化非活动干净页列表 */
+        memset(&zone->stat, 0, sizeof(zone->stat)); /* 清空伙伴系统统计计数 */
+
+        /* 初始化每个cpu的冷热页缓存，每批搬运的页面数约为区域大小的1/1024，
+        但一批不超过256KB的1/4，至少为1页 */
+        batch = realsize / 1024;
+        if (batch * PAGE_SIZE > 256 * 1024)
+            batch = (256 * 1024) / PAGE_SIZE;
+        batch /= 4;
+        if (batch < 1)
+            batch = 1;
+        for (cpu = 0; cpu < NR_CPUS; cpu++)
+        {
+            per_cpu_pages_t *pcp;
+            int t;
+
+            pcp = &zone->pageset[cpu].pcp[0]; /* 热页缓存 */
+            pcp->count = 0;
+            pcp->low = 2 * batch;
+            pcp->high = 6 * batch;
+            pcp->batch = 1 * batch;
+            for (t = 0; t < MIGRATE_TYPES; t++)
+                memlist_init(&pcp->lists[t]);
+
+            pcp = &zone->pageset[cpu].pcp[1]; /* 冷页缓存 */
+            pcp->count = 0;
+            pcp->low = 0;
+            pcp->high = 2 * batch;
+            pcp->batch = 1 * batch;
+            for (t = 0; t < MIGRATE_TYPES; t++)
+                memlist_init(&pcp->lists[t]);
+        }
         if (!size)                                  /* 如果 size 为 0，意味着该区域没有内存页，继续处理下一个区域 */
             continue;
 
@@ -224,26 +326,33 @@ void __init free_area_init_core(int nid, pg_data_t *pgdat, struct page **gmap,
         zone->zone_mem_map = mem_map + offset;     /* zone指向本区域第一个page的指针指向管理整个系统的page数组对应位置 */
         zone->zone_start_mapnr = offset;           /* 设置了区域开始的内存映射编号 */
         zone->zone_start_paddr = zone_start_paddr; /* 设置当前内存区域的起始物理地址 */
+        zone_start_paddr += size << PAGE_SHIFT;    /* 下一个区域的起始物理地址 */
 
-        for (i = 0; i < size; i++) /* 循环遍历当前内存区域中的每一页 */
-        {
-            struct page *page = mem_map + offset + i; /* 获取当前页面的指针 */
-            /* 将当前页面的 zone 字段设置为当前内存区域。这样，每个页面都知道它属于哪个内存区域 */
-            page->zone = zone;
-            if (j != ZONE_HIGHMEM) /* 检查当前区域是否不是高内存区域 */
-            {
+        /* 为zone分配页面等待队列哈希表，取代每个页描述符中的等待队列 */
+        zone->wait_table_size = wait_table_size(size);
+        zone->wait_table_shift = BITS_PER_LONG - wait_table_bits(zone->wait_table_size);
+        zone->wait_table = (wait_queue_head_t *)alloc_bootmem_node(pgdat, zone->wait_table_size * sizeof(wait_queue_head_t));
+        for (i = 0; i < zone->wait_table_size; i++)
+            init_waitqueue_head(zone->wait_table + i);
 
-                page->virtual = __va(zone_start_paddr); /* 设置页面在内核地址空间映射的虚拟地址 */
-                zone_start_paddr += PAGE_SIZE;          /* 更新区域的起始物理地址，为下一个页面准备 */
-            }
-        }
+        /* 为每个pageblock记录迁移类型，启动时所有pageblock都属于MIGRATE_MOVABLE，
+        内核自己的分配会在第一次借用时把整个pageblock拿过去 */
+        nr_pageblocks = (size + pageblock_nr_pages - 1) >> pageblock_order;
+        zone->pageblock_type = (unsigned char *)alloc_bootmem_node(pgdat, LONG_ALIGN(nr_pageblocks));
+        memset(zone->pageblock_type, MIGRATE_MOVABLE, nr_pageblocks);
 
         offset += size;                 /* offset增加当前区域的大小。这样，在处理下一个区域时，offset 指向正确的起始位置 */
         mask = -1;                      /* 在 C 语言中，-1 表示所有位都设置为 1。这个 mask 将用于计算位图的大小 */
         for (i = 0; i < MAX_ORDER; i++) /* 初始化每个zone的伙伴系统（也就是zone内那10个free_area_t结构体） */
         {
+            int t; /* 遍历迁移类型 */
+#ifndef CONFIG_BUDDY_PAGE_ORDER /* 否则块的空闲状态与阶记录在struct page中，不需要为每个阶分配位图 */
             unsigned long bitmap_size;                   /* 用于存储计算出的位图大小的变量 */
-            memlist_init(&zone->free_area[i].free_list); /* 初始化当前区域所有伙伴系统内存池的空闲内存块链表 */
+#endif
+
+            for (t = 0; t < MIGRATE_TYPES; t++)
+                memlist_init(&zone->free_area[i].free_list[t]); /* 初始化当前区域所有伙伴系统内存池每种迁移类型的空闲内存块链表 */
+#ifndef CONFIG_BUDDY_PAGE_ORDER
             mask += mask;                                /* 通过将 mask 的当前值加倍来更新 mask。在位操作中，这相当于将 mask 左移一位 */
             /* 这个操作实际上是将 size 增加到足够大，以至于能被 mask 定义的对齐边界整除。
             然后，使用 & mask 操作确保结果是对齐的，-2表示2字节对齐，-4表示4字节对齐。也就是最后size是向上取整到mask对应的倍数 */
@@ -257,8 +366,24 @@ void __init free_area_init_core(int nid, pg_data_t *pgdat, struct page **gmap,
             bitmap_size = LONG_ALIGN(bitmap_size); /* bitmap_size 向上对齐到最近的 long 类型的边界 */
             /* 为每个阶分配位图 */
             zone->free_area[i].map = (unsigned int *)alloc_bootmem_node(pgdat, bitmap_size);
+#endif
         }
     }
+
+    /* 所有zone的范围都确定之后，一次遍历完成页描述符的初始化 */
+    t0 = get_cycles();
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+    /* 只初始化前DEFERRED_INIT_SYNC_PAGES个页面，至少覆盖整个DMA区域，其余的推迟 */
+    pgdat->first_deferred_pfn = DEFERRED_INIT_SYNC_PAGES;
+    if (pgdat->first_deferred_pfn < zones_size[ZONE_DMA])
+        pgdat->first_deferred_pfn = zones_size[ZONE_DMA];
+    if (pgdat->first_deferred_pfn > totalpages)
+        pgdat->first_deferred_pfn = totalpages;
+    memmap_init_range(pgdat, 0, pgdat->first_deferred_pfn);
+#else
+    memmap_init_range(pgdat, 0, totalpages);
+#endif
+    memmap_init_cycles += get_cycles() - t0;
     build_zonelists(pgdat);
 }
 
@@ -271,24 +396,42 @@ void __init free_area_init(unsigned long *zones_size)
 }
 
 /* 检查一个页面x是否在zone范围之内 */
-#define BAD_RANGE(zone, x) (((zone) != (x)->zone) || (((x)-mem_map) < (zone)->offset) || (((x)-mem_map) >= (zone)->offset + (zone)->size))
+#define BAD_RANGE(zone, x) (((zone) != page_zone(x)) || ((unsigned long)((x)-mem_map) < (zone)->offset) || ((unsigned long)((x)-mem_map) >= (zone)->offset + (zone)->size))
 
-/* 释放伙伴系统中的块，并合并成更大的块, 参数：
-page：释放的内存页的 struct page 结构的指针
-order：要释放的内存页的大小，以 2 的幂为单位 */
-static void __free_pages_ok(struct page *page, unsigned long order)
+/* 返回页面所在pageblock的迁移类型，参数：
+page：要查询的页面 */
+static inline int get_pageblock_migratetype(struct page *page)
 {
-    /* index: 用于存储释放和伙伴块在其伙伴系统（buddy system）中的索引。
-    page_idx: 用于存储当前正在处理的页面相对于其内存区域（zone）的基地址的索引
-    mask: 用于计算和操作内存页索引的掩码
-    flags: 用于保存在执行自旋锁操作时的中断状态，确保线程安全 */
-    unsigned long index, page_idx, mask, flags;
-    /* area: 指向 free_area_t 结构的指针，这个结构用于表示不同阶（order）的空闲页面链表。
-    每个阶的空闲页面链表包含了相应大小的空闲内存块 */
-    free_area_t *area;
-    struct page *base; /* base: 指向内存区域（zone）中第一个 page 结构的指针。 */
-    zone_t *zone;      /* zone: 指向 zone_t 结构的指针，表示当前页面所在的内存区域。 */
+    zone_t *zone = page_zone(page);
+
+    return zone->pageblock_type[(page - zone->zone_mem_map) >> pageblock_order];
+}
+
+/* 设置页面所在pageblock的迁移类型，调用者需持有zone->lock，参数：
+page：pageblock中的任意一个页面
+migratetype：新的迁移类型 */
+static inline void set_pageblock_migratetype(struct page *page, int migratetype)
+{
+    zone_t *zone = page_zone(page);
+
+    zone->pageblock_type[(page - zone->zone_mem_map) >> pageblock_order] = migratetype;
+}
 
+/* 根据分配请求的GFP掩码得到要分配的页面的迁移类型，参数：
+gfp_mask：分配请求的GFP掩码 */
+static inline int gfpflags_to_migratetype(int gfp_mask)
+{
+    if (gfp_mask & __GFP_MOVABLE)
+        return MIGRATE_MOVABLE;
+    if (gfp_mask & __GFP_RECLAIMABLE)
+        return MIGRATE_RECLAIMABLE;
+    return MIGRATE_UNMOVABLE;
+}
+
+/* 检查一个要释放的页面是否处于可以释放的状态，并重置其referenced、dirty位与年龄，参数：
+page：释放的内存页的 struct page 结构的指针 */
+static inline void free_pages_check(struct page *page)
+{
     if (page->buffers)
         /* 进入if，说明试图释放一个仍然有缓冲区的页面，报错 */
         BUG();
@@ -321,11 +464,30 @@ static void __free_pages_ok(struct page *page, unsigned long order)
         /* 进入if，表示该页面是非活跃页面但是是干净的，也不能释放，
         因为非活跃页面可能包含了之前被使用过但目前暂时不活跃的数据。这些数据可能在未来会再次被访问 */
         BUG();
+    if (PageBuddy(page))
+        /* 进入if，表示该页面已经是伙伴系统中的空闲块，说明被重复释放了 */
+        BUG();
 
     page->flags &= ~((1 << PG_referenced) | (1 << PG_dirty)); /* 清除referenced和dirty位 */
     page->age = PAGE_AGE_START;                               /* 将页面的年龄设置为初始值 */
+}
 
-    zone = page->zone; /* 得到页面所在的内存区 */
+/* 将一个块放回伙伴系统，并不断与空闲的伙伴块合并成更大的块，调用者需持有zone->lock。
+伙伴块不论挂在哪种迁移类型的链表上都可以合并，因为合并不会跨越pageblock，合并后的块挂在migratetype的链表上。参数：
+page：释放的块的第一个页面
+zone：块所在的内存区域
+order：块的大小，以 2 的幂为单位
+migratetype：块所在pageblock的迁移类型 */
+static inline void __free_one_page(struct page *page, zone_t *zone, unsigned long order, int migratetype)
+{
+    /* index: 用于存储释放和伙伴块在其伙伴系统（buddy system）中的索引。
+    page_idx: 用于存储当前正在处理的页面相对于其内存区域（zone）的基地址的索引
+    mask: 用于计算和操作内存页索引的掩码 */
+    unsigned long index, page_idx, mask;
+    /* area: 指向 free_area_t 结构的指针，这个结构用于表示不同阶（order）的空闲页面链表。
+    每个阶的空闲页面链表包含了相应大小的空闲内存块 */
+    free_area_t *area;
+    struct page *base; /* base: 指向内存区域（zone）中第一个 page 结构的指针。 */
 
     mask = (~0UL) << order;        /* 创建一个掩码，高位全是1，低order位全是0 */
     base = mem_map + zone->offset; /* 得到页面所在内存区域起始页面的struct page */
@@ -339,8 +501,7 @@ static void __free_pages_ok(struct page *page, unsigned long order)
     如果两个页面都空闲或都在使用，那么这个位就是0。所以当释放页面的时候，检查这个位如果位1，就证明了另一个伙伴块是
     空闲的。为什么这样，需要深入理解伙伴系统的页面分配机制。文章：https://www.bilibili.com/read/cv16402064/ */
     index = page_idx >> (1 + order);
-    area = zone->free_area + order;        /* 根据页面的大小（order），获取对应的 free_area 结构 */
-    spin_lock_irqsave(&zone->lock, flags); /* 获取自旋锁的同时关闭本地中断，保存当前中断状态到flags */
+    area = zone->free_area + order; /* 根据页面的大小（order），获取对应的 free_area 结构 */
     /* 从区域的空闲页面计数中加上相应数量的页面，mask 在此处表示释放的页面数，
     因为它是根据页面的大小（order）计算出来的，前面全是1，后面跟几个0，是负数的表达 */
     zone->free_pages -= mask;
@@ -353,10 +514,17 @@ static void __free_pages_ok(struct page *page, unsigned long order)
         if (area >= zone->free_area + MAX_ORDER)
             /* 进入if，说明超过了 */
             BUG();
+#ifdef CONFIG_BUDDY_PAGE_ORDER
+        /* 伙伴块超出了zone的范围，或者伙伴块的第一个页面没有标记为同样大小的空闲块，就不能合并，退出 */
+        if ((page_idx ^ -mask) >= zone->size ||
+            !page_is_buddy(base + (page_idx ^ -mask), area - zone->free_area))
+            break;
+#else
         /* 检查并取反位图中相应的位，以确定伙伴块是空闲的 */
         if (!test_and_change_bit(index, area->map))
             /* 进入if，说明对应位是0，表示释放块与伙伴块都是空闲或占用，退出 */
             break;
+#endif
         /* 来到这里，说明上面的位是1，说明释放块的伙伴块是空闲的，可以合并 */
         /* 得到可以和要释放的块进行合并的块的页面 */
         buddy1 = base + (page_idx ^ -mask);
@@ -367,6 +535,8 @@ static void __free_pages_ok(struct page *page, unsigned long order)
             BUG();
         /* 将可以和要释放的块进行合并的块的页面从free_area_t的链表中释放 */
         memlist_del(&buddy1->list);
+        rmv_page_order(buddy1); /* 伙伴块不再是独立的空闲块 */
+        zone_stat_inc(zone, merge, area - zone->free_area);
         mask <<= 1; /* 更新 mask 来表示更大的内存块大小 */
         area++;     /* 将 area 指针移动到更高的阶 */
         /* 更新 index 和 page_idx 来反映新的伙伴块的位置和大小 */
@@ -375,13 +545,591 @@ static void __free_pages_ok(struct page *page, unsigned long order)
         index >>= 1;
         page_idx &= mask; /* 得到两个块合并后的更大块的起始页在zone中的偏移 */
     }
+    /* 在块的第一个页面中记录这是一个空闲块以及块的阶 */
+    set_page_order(base + page_idx, area - zone->free_area);
     /* 将页面（或合并后的更大页面块）加入到相应阶的空闲链表中 */
-    memlist_add_head(&(base + page_idx)->list, &area->free_list);
+    memlist_add_head(&(base + page_idx)->list, &area->free_list[migratetype]);
+}
+
+/* 释放伙伴系统中的块，并合并成更大的块, 参数：
+page：释放的内存页的 struct page 结构的指针
+order：要释放的内存页的大小，以 2 的幂为单位 */
+static void __free_pages_ok(struct page *page, unsigned long order)
+{
+    unsigned long flags;     /* 用于保存在执行自旋锁操作时的中断状态，确保线程安全 */
+    zone_t *zone;            /* 页面所在的内存区域 */
+
+    free_pages_check(page);  /* 检查页面是否可以释放 */
+    zone = page_zone(page);  /* 得到页面所在的内存区 */
+
+    spin_lock_irqsave(&zone->lock, flags);      /* 获取自旋锁的同时关闭本地中断，保存当前中断状态到flags */
+    zone->stat.lock++;
+    zone_stat_inc(zone, free, order);
+    __free_one_page(page, zone, order, get_pageblock_migratetype(page)); /* 放回伙伴系统并合并 */
     spin_unlock_irqrestore(&zone->lock, flags); /* 释放自旋锁，并恢复之前保存的中断状态 */
     if (memory_pressure > NR_CPUS)              /* 见memory_pressure值含义解释 */
         memory_pressure--;
 }
 
+/* 将一个cpu页面缓存中的count个0阶页面一次性放回伙伴系统，整批只获取一次zone->lock，
+各迁移类型的链表轮流从尾部（最冷的一端）取下一个页面，避免某一种类型的页面被单独耗尽。参数：
+zone：页面所在的内存区域
+count：要放回的页面数
+pcp：页面所在的cpu页面缓存
+返回：实际放回的页面数 */
+static int free_pages_bulk(zone_t *zone, int count, per_cpu_pages_t *pcp)
+{
+    unsigned long flags;
+    int migratetype = 0;
+    int empty = 0; /* 连续遇到的空链表数，等于MIGRATE_TYPES说明缓存已经空了 */
+    int ret = 0;
+
+    spin_lock_irqsave(&zone->lock, flags);
+    zone->stat.lock++;
+    zone->stat.pcp_drain++;
+    while (count > 0 && empty < MIGRATE_TYPES)
+    {
+        struct list_head *list = &pcp->lists[migratetype];
+        struct page *page;
+
+        if (++migratetype == MIGRATE_TYPES)
+            migratetype = 0;
+        if (list_empty(list))
+        {
+            empty++;
+            continue;
+        }
+        empty = 0;
+        page = memlist_entry(list->prev, struct page, list);
+        memlist_del(&page->list);
+        __free_one_page(page, zone, 0, get_pageblock_migratetype(page));
+        count--;
+        ret++;
+    }
+    spin_unlock_irqrestore(&zone->lock, flags);
+    return ret;
+}
+
+#ifdef CONFIG_BUDDY_PAGE_ORDER
+/* 块的空闲状态记录在块第一个页面的struct page中，没有位图需要维护 */
+#define MARK_USED(index, order, area) \
+    do                                \
+    {                                 \
+    } while (0)
+#else
+/* 将伙伴系统位图中某个块与其伙伴块对应的位取反，表示两者之一的使用状态发生了变化，参数：
+index：块的第一个页面在zone中的偏移
+order：块的大小，以 2 的幂为单位
+area：块所在阶的free_area_t */
+#define MARK_USED(index, order, area) \
+    test_and_change_bit((index) >> (1 + (order)), (area)->map)
+#endif
+
+/* 将一个从高阶（high）链表上摘下的大块不断对半拆分，后一半留给自己继续拆，
+前一半挂入低一阶的空闲链表，直到拆分出大小为low阶的块。参数：
+zone：块所在的内存区域
+page：大块的第一个页面
+index：大块的第一个页面在zone中的偏移
+low：需要的块大小，以 2 的幂为单位
+high：摘下的大块的大小，以 2 的幂为单位
+area：大块所在阶的free_area_t
+migratetype：拆出的多余部分挂入哪种迁移类型的空闲链表
+返回：拆分出来的low阶块的第一个页面 */
+static inline struct page *expand(zone_t *zone, struct page *page,
+                                  unsigned long index, int low, int high, free_area_t *area,
+                                  int migratetype)
+{
+    unsigned long size = 1 << high; /* 当前块的页面数 */
+
+    while (high > low) /* 块比需要的大，就继续拆分 */
+    {
+        if (BAD_RANGE(zone, page)) /* 检查页面在内存区域的有效范围内 */
+            BUG();
+        zone_stat_inc(zone, split, high);
+        area--;     /* 移动到低一阶的free_area_t */
+        high--;     /* 块大小减半 */
+        size >>= 1; /* 拆分后每一半的页面数 */
+        /* 前一半挂入低一阶的空闲链表 */
+        memlist_add_head(&(page)->list, &(area)->free_list[migratetype]);
+        set_page_order(page, high);
+        /* 前一半空闲，后一半被使用，这一对伙伴的状态不同，位图中对应位取反置1 */
+        MARK_USED(index, high, area);
+        index += size; /* 后一半继续参与拆分 */
+        page += size;
+    }
+    if (BAD_RANGE(zone, page))
+        BUG();
+    return page;
+}
+
+/* 从一个内存区域的伙伴系统中分配2的order次方个连续页面，只在migratetype的空闲链表中寻找，
+从order阶开始向高阶寻找非空的空闲链表，找到后摘下第一个块，若块比需要的大就通过expand拆分，
+拆出的多余部分仍然挂回migratetype的链表。调用者需持有zone->lock。参数：
+zone：要从中分配的内存区域
+order：要分配的页面数，以 2 的幂为单位
+migratetype：要分配的页面的迁移类型
+返回：分配到的第一个页面，失败返回NULL */
+static struct page *__rmqueue_smallest(zone_t *zone, unsigned long order, int migratetype)
+{
+    free_area_t *area = zone->free_area + order; /* 从order阶的free_area_t开始寻找 */
+    unsigned long curr_order = order;            /* 当前查找的阶 */
+    struct list_head *head, *curr;               /* 空闲链表头与链表上第一个节点 */
+    struct page *page;
+
+    do
+    {
+        head = &area->free_list[migratetype];
+        curr = memlist_next(head);
+
+        if (curr != head) /* 当前阶的空闲链表非空 */
+        {
+            unsigned int index;
+
+            page = memlist_entry(curr, struct page, list); /* 得到链表上第一个块的第一个页面 */
+            if (BAD_RANGE(zone, page))
+                BUG();
+            memlist_del(curr);                       /* 将这个块从空闲链表中摘下 */
+            rmv_page_order(page);                    /* 块不再是空闲块 */
+            index = (page - mem_map) - zone->offset; /* 计算块在zone中的偏移 */
+            if (curr_order != MAX_ORDER - 1)         /* 最高阶的块没有伙伴，释放时不会合并，也就不维护位图 */
+                MARK_USED(index, curr_order, area);  /* 块被使用了，位图中对应位取反 */
+            zone->free_pages -= 1 << order;          /* 区域的空闲页面数减去实际分配出去的页面数 */
+
+            /* 块比需要的大，就拆分，多余的部分挂入低阶空闲链表 */
+            return expand(zone, page, index, order, curr_order, area, migratetype);
+        }
+        curr_order++; /* 当前阶没有空闲块，去更高的一阶寻找 */
+        area++;
+    } while (curr_order < MAX_ORDER);
+
+    return NULL;
+}
+
+/* 一种迁移类型的链表都为空时，依次向哪些迁移类型借用 */
+static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES - 1] = {
+    {MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE},   /* MIGRATE_UNMOVABLE */
+    {MIGRATE_UNMOVABLE, MIGRATE_MOVABLE},     /* MIGRATE_RECLAIMABLE */
+    {MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE}, /* MIGRATE_MOVABLE */
+};
+
+#ifdef CONFIG_BUDDY_PAGE_ORDER
+/* 把page所在pageblock中所有的空闲块移到migratetype的空闲链表上，调用者需持有zone->lock。
+空闲块的第一个页面带有PG_buddy标志与块的阶，所以可以直接按块跳着遍历，参数：
+zone：pageblock所在的内存区域
+page：pageblock中的任意一个页面
+migratetype：要移到的迁移类型
+返回：移动的空闲页面数 */
+static unsigned long move_freepages_block(zone_t *zone, struct page *page, int migratetype)
+{
+    struct page *base = zone->zone_mem_map;
+    unsigned long idx, end;
+    unsigned long order, moved = 0;
+
+    idx = (page - base) & ~(pageblock_nr_pages - 1); /* pageblock的第一个页面 */
+    end = idx + pageblock_nr_pages;
+    if (end > zone->size) /* zone的最后一个pageblock可能不完整 */
+        end = zone->size;
+
+    while (idx < end)
+    {
+        page = base + idx;
+        if (!PageBuddy(page)) /* 不是空闲块的开头，跳过这一页 */
+        {
+            idx++;
+            continue;
+        }
+        order = page_order(page);
+        memlist_del(&page->list);
+        memlist_add_head(&page->list, &zone->free_area[order].free_list[migratetype]);
+        idx += 1UL << order;
+        moved += 1UL << order;
+    }
+    return moved;
+}
+#else
+/* 位图方式下无法从struct page得知一个页面是否是空闲块的开头，不移动其他空闲块，
+它们被再次分配、释放之后自然会回到新类型的链表上。返回0 */
+#define move_freepages_block(zone, page, migratetype) 0UL
+#endif
+
+/* migratetype的空闲链表中没有足够大的块时，向其他迁移类型借用。与__rmqueue_smallest相反，
+这里从最高阶开始向下寻找，借用尽可能大的块，减少以后再次借用的次数，也就减少了不同类型混在同一pageblock中的情况。
+借用的块足够大（至少半个pageblock）时，把这个pageblock中所有的空闲块都移到自己的链表上，
+如果其中空闲页面超过一半，就把整个pageblock的所有权也拿过来。调用者需持有zone->lock。参数：
+zone：要从中分配的内存区域
+order：要分配的页面数，以 2 的幂为单位
+start_migratetype：要分配的页面的迁移类型
+返回：分配到的第一个页面，失败返回NULL */
+static struct page *__rmqueue_fallback(zone_t *zone, unsigned long order, int start_migratetype)
+{
+    free_area_t *area;
+    int current_order, i, migratetype;
+    unsigned long index;
+    struct page *page;
+
+    for (current_order = MAX_ORDER - 1; current_order >= (int)order; current_order--)
+    {
+        area = zone->free_area + current_order;
+        for (i = 0; i < MIGRATE_TYPES - 1; i++)
+        {
+            migratetype = fallbacks[start_migratetype][i];
+            if (list_empty(&area->free_list[migratetype]))
+                continue;
+
+            page = memlist_entry(memlist_next(&area->free_list[migratetype]), struct page, list);
+            if (BAD_RANGE(zone, page))
+                BUG();
+            zone_stat_inc(zone, fallback, current_order);
+
+            /* 借用的是大块，就把整个pageblock的空闲块都拿过来，自己以后的分配会继续使用这个pageblock */
+            if (current_order >= pageblock_order / 2)
+            {
+                unsigned long pages = move_freepages_block(zone, page, start_migratetype);
+
+                if (pages < (1UL << current_order)) /* 位图方式下只知道借用的块本身 */
+                    pages = 1UL << current_order;
+                if (pages >= pageblock_nr_pages / 2)
+                {
+                    set_pageblock_migratetype(page, start_migratetype);
+                    zone->stat.pageblock_steal++;
+                }
+                migratetype = start_migratetype;
+            }
+
+            memlist_del(&page->list);
+            rmv_page_order(page);
+            index = (page - mem_map) - zone->offset;
+            if (current_order != MAX_ORDER - 1)
+                MARK_USED(index, current_order, area);
+            zone->free_pages -= 1 << order;
+
+            /* 多余部分挂在哪种类型的链表上取决于是否拿到了这个pageblock */
+            return expand(zone, page, index, order, current_order, area, migratetype);
+        }
+    }
+    return NULL;
+}
+
+/* 从一个内存区域的伙伴系统中分配2的order次方个migratetype类型的连续页面，
+先在自己类型的空闲链表中寻找，没有再向其他类型借用。调用者需持有zone->lock。参数：
+zone：要从中分配的内存区域
+order：要分配的页面数，以 2 的幂为单位
+migratetype：要分配的页面的迁移类型
+返回：分配到的第一个页面，失败返回NULL */
+static struct page *__rmqueue(zone_t *zone, unsigned long order, int migratetype)
+{
+    struct page *page;
+
+    page = __rmqueue_smallest(zone, order, migratetype);
+    if (page == NULL)
+        page = __rmqueue_fallback(zone, order, migratetype);
+    return page;
+}
+
+/* 从伙伴系统中一次性取出count个order阶的块挂到list尾部，整批只获取一次zone->lock，
+每个块都记下它是按哪种迁移类型取出来的。参数：
+zone：要从中分配的内存区域
+order：块的大小，以 2 的幂为单位
+count：要取出的块数
+list：取出的块要挂入的链表
+migratetype：要取出的块的迁移类型
+返回：实际取出的块数 */
+static int rmqueue_bulk(zone_t *zone, unsigned long order, int count, struct list_head *list, int migratetype)
+{
+    unsigned long flags;
+    int i, allocated = 0;
+    struct page *page;
+
+    spin_lock_irqsave(&zone->lock, flags);
+    zone->stat.lock++;
+    zone->stat.pcp_refill++;
+    for (i = 0; i < count; i++)
+    {
+        page = __rmqueue(zone, order, migratetype);
+        if (page == NULL) /* 伙伴系统中已经没有这么大的块了 */
+            break;
+        allocated++;
+        set_page_migratetype(page, migratetype);
+        __list_add(&page->list, list->prev, list); /* 挂到链表尾部 */
+    }
+    spin_unlock_irqrestore(&zone->lock, flags);
+    return allocated;
+}
+
+/* 从一个内存区域分配2的order次方个连续页面。0阶分配走本cpu的冷热页缓存，
+缓存中的页面数降到low以下时才从伙伴系统批量补充batch个，所以绝大多数单页分配
+既不获取zone->lock，也不需要拆分块与修改位图；高阶分配直接走伙伴系统。
+缓存中每种迁移类型有自己的链表，分配时直接取对应链表头部最热的页面。参数：
+zone：要从中分配的内存区域
+order：要分配的页面数，以 2 的幂为单位
+gfp_mask：分配请求的GFP掩码，__GFP_COLD表示调用者想要缓存中“冷”的页面，
+__GFP_MOVABLE与__GFP_RECLAIMABLE决定页面的迁移类型
+返回：分配到的第一个页面，失败返回NULL */
+static struct page *buffered_rmqueue(zone_t *zone, unsigned long order, int gfp_mask)
+{
+    unsigned long flags;
+    struct page *page = NULL;
+    int cold = !!(gfp_mask & __GFP_COLD);
+    int migratetype = gfpflags_to_migratetype(gfp_mask);
+
+    if (order == 0)
+    {
+        per_cpu_pages_t *pcp;
+        struct list_head *list;
+
+        pcp = &zone->pageset[smp_processor_id()].pcp[cold];
+        list = &pcp->lists[migratetype];
+        local_irq_save(flags); /* 只需要关本地中断，缓存是本cpu私有的 */
+        /* 缓存中的页面过少，或者没有这种类型的页面，就从伙伴系统补充一批 */
+        if (pcp->count <= pcp->low || list_empty(list))
+            pcp->count += rmqueue_bulk(zone, 0, pcp->batch, list, migratetype);
+        if (!list_empty(list))
+        {
+            page = memlist_entry(list->next, struct page, list);
+            memlist_del(&page->list);
+            pcp->count--;
+        }
+        local_irq_restore(flags);
+    }
+
+    if (page == NULL) /* 高阶分配，或者伙伴系统中已经凑不出一批0阶页面 */
+    {
+        spin_lock_irqsave(&zone->lock, flags);
+        zone->stat.lock++;
+        page = __rmqueue(zone, order, migratetype);
+        spin_unlock_irqrestore(&zone->lock, flags);
+    }
+
+    if (page != NULL)
+    {
+        if (BAD_RANGE(zone, page))
+            BUG();
+        zone_stat_inc(zone, alloc, order);
+        set_page_count(page, 1); /* 分配出去的页面引用计数为1 */
+    }
+    return page;
+}
+
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+/* zone中还有没有初始化的页描述符时，初始化并释放一块，参数：
+zone：空闲页面不足的内存区域
+返回：做了初始化返回1，zone中已经没有延迟的页面返回0 */
+static int deferred_grow_zone(zone_t *zone)
+{
+    pg_data_t *pgdat = zone->zone_pgdat;
+
+    /* 延迟的页面按页号从低到高处理，zone之前的zone中的页面也要先处理完 */
+    if (pgdat->first_deferred_pfn >= zone->zone_start_mapnr - pgdat->node_start_mapnr + zone->size)
+        return 0;
+    deferred_init_memmap_chunk(pgdat);
+    return 1;
+}
+
+/* 启动的最后，完成所有节点剩余的页描述符初始化并释放这些页面，打印同步与延迟初始化各自花费的时间。
+Linux中每个节点由一个内核线程在后台完成这项工作，我们还没有内核线程，就在start_kernel的最后调用 */
+void page_alloc_init_late(void)
+{
+    pg_data_t *pgdat;
+    unsigned long deferred = 0, freed = 0, reserved = 0, start, i;
+    cycles_t t0, cycles, sync_us;
+
+    t0 = get_cycles();
+    for (pgdat = pgdat_list; pgdat; pgdat = pgdat->node_next)
+    {
+        start = pgdat->first_deferred_pfn;
+        while (pgdat->first_deferred_pfn < pgdat->node_size)
+            freed += deferred_init_memmap_chunk(pgdat);
+        deferred += pgdat->node_size - start;
+        for (i = start; i < pgdat->node_size; i++) /* mem_init没有统计到的保留页面 */
+            if (PageReserved(pgdat->node_mem_map + i))
+                reserved++;
+    }
+    cycles = get_cycles() - t0;
+
+    printk("Deferred struct page init: %lu pages deferred, %lu freed, %lu reserved",
+           deferred, freed, reserved);
+    if (cpu_khz) /* 换算成微秒：周期数 * 1000 / kHz */
+    {
+        sync_us = memmap_init_cycles * 1000;
+        do_div(sync_us, cpu_khz);
+        cycles *= 1000;
+        do_div(cycles, cpu_khz);
+        printk(", boot-time init %lu us, deferred init %lu us", (unsigned long)sync_us, (unsigned long)cycles);
+    }
+    printk("\n");
+}
+#endif
+
+/* 伙伴系统分配页面的核心接口，按照zonelist中zone的优先级依次尝试分配，分为三轮：
+第一轮要求zone分配后空闲页面仍然高于pages_low，这样分配不会给该区域带来内存压力；
+第二轮放宽到pages_min，对于不能睡眠的分配请求再放宽到pages_min的1/4；
+最后，正在为回收内存而分配内存的任务（PF_MEMALLOC）可以无视水位线。
+由于每个zone的水位线依次累加，优先级较低的zone（如DMA区域）会为更专门的分配保留更多页面。
+参数：
+zonelist：按优先级排列的可用于本次分配的zone列表
+order：要分配的页面数，以 2 的幂为单位
+返回：分配到的第一个页面，失败返回NULL */
+struct page *__alloc_pages(zonelist_t *zonelist, unsigned long order)
+{
+    zone_t **zone;                         /* 遍历zonelist */
+    unsigned long min;                     /* 累加的水位线 */
+    int gfp_mask = zonelist->gfp_mask;     /* 分配请求的GFP掩码 */
+    struct page *page;
+
+    memory_pressure++; /* 见memory_pressure值含义解释 */
+
+try_low:
+    zone = zonelist->zones;
+    min = 1UL << order; /* 分配后至少还要剩下这么多页面 */
+    for (;;)            /* 第一轮，按pages_low检查 */
+    {
+        zone_t *z = *(zone++);
+        if (!z) /* zonelist以NULL结尾 */
+            break;
+
+        min += z->pages_low;
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+        /* 这个zone还有页面没有交给伙伴系统，先初始化并释放一块，而不是去动用优先级更低的zone */
+        while (z->free_pages <= min && deferred_grow_zone(z))
+            ;
+#endif
+        if (z->free_pages > min)
+        {
+            page = buffered_rmqueue(z, order, gfp_mask);
+            if (page)
+                return page;
+        }
+        else
+            zone_stat_inc(z, wmark_low, order);
+    }
+
+    /* 所有zone的空闲页面都降到了pages_low以下。我们还没有kswapd，
+    就地把slab缓存池中全空的slab还给伙伴系统，回收到了页面就再按pages_low试一次。
+    与Linux2.4一样只为可以睡眠的请求回收：原子分配可能来自中断，被打断的代码也许正在操作某个缓存池的对象数组。
+    slab增长时分配页面也会走到这里，回收中清空对象数组、释放slab时如果又分配页面，就会再次进入回收，
+    挡住这种重入的是kmem_cache_reap开头的down_trylock：外层回收持有cache_chain_sem，内层直接返回0 */
+    if ((gfp_mask & __GFP_WAIT) && kmem_cache_reap())
+        goto try_low;
+
+    zone = zonelist->zones;
+    min = 1UL << order;
+    for (;;) /* 第二轮，按pages_min检查 */
+    {
+        unsigned long local_min;
+        zone_t *z = *(zone++);
+        if (!z)
+            break;
+
+        local_min = z->pages_min;
+        if (!(gfp_mask & __GFP_WAIT)) /* 不能睡眠等待回收的分配请求，允许动用更多的保留页面 */
+            local_min >>= 2;
+        min += local_min;
+        if (z->free_pages > min)
+        {
+            page = buffered_rmqueue(z, order, gfp_mask);
+            if (page)
+                return page;
+        }
+        else
+            zone_stat_inc(z, wmark_min, order);
+    }
+
+    /* 来到这里，说明内存已经非常紧张。我们还没有页面回收机制，
+    只有为回收内存而分配内存的任务可以动用最后的保留页面 */
+    if (current->flags & PF_MEMALLOC)
+    {
+        zone = zonelist->zones;
+        for (;;)
+        {
+            zone_t *z = *(zone++);
+            if (!z)
+                break;
+
+            page = buffered_rmqueue(z, order, gfp_mask);
+            if (page)
+                return page;
+        }
+    }
+
+    if (zonelist->zones[0])
+        zone_stat_inc(zonelist->zones[0], fail, order); /* 失败记在首选zone上 */
+    printk("__alloc_pages: %lu-order allocation failed (gfp=0x%x).\n", order, gfp_mask);
+    return NULL;
+}
+
+/* 分配2的order次方个连续页面，返回第一个页面的虚拟地址，参数：
+gfp_mask：分配请求的GFP掩码
+order：要分配的页面数，以 2 的幂为单位
+返回：分配到的页面的虚拟地址，失败返回0 */
+unsigned long __get_free_pages(int gfp_mask, unsigned long order)
+{
+    struct page *page;
+
+    page = alloc_pages(gfp_mask, order);
+    if (!page)
+        return 0;
+    return (unsigned long)page_address(page);
+}
+
+/* 分配一个页面并将其清零，返回其虚拟地址，参数：
+gfp_mask：分配请求的GFP掩码 */
+unsigned long get_zeroed_page(int gfp_mask)
+{
+    struct page *page;
+
+    page = alloc_pages(gfp_mask, 0);
+    if (page)
+    {
+        void *address = page_address(page);
+        clear_page(address);
+        return (unsigned long)address;
+    }
+    return 0;
+}
+
+/* 将一个0阶页面放入本cpu的冷热页缓存，热页放在链表头部，冷页放在链表尾部。
+缓存中的页面数达到high时，一次性把batch个最冷的页面还给伙伴系统。参数：
+page：要释放的页面
+cold：是否是冷页面（内容已经不在cpu缓存中，如刚完成DMA的页面） */
+static void free_hot_cold_page(struct page *page, int cold)
+{
+    zone_t *zone = page_zone(page);
+    per_cpu_pages_t *pcp;
+    struct list_head *list;
+    unsigned long flags;
+
+    free_pages_check(page); /* 检查页面是否可以释放 */
+    set_page_migratetype(page, get_pageblock_migratetype(page)); /* 以后按页面所在pageblock的类型分配出去 */
+    pcp = &zone->pageset[smp_processor_id()].pcp[cold];
+    list = &pcp->lists[page_migratetype(page)];
+    local_irq_save(flags);
+    if (cold)
+        __list_add(&page->list, list->prev, list); /* 冷页挂到链表尾部 */
+    else
+        memlist_add_head(&page->list, list); /* 热页挂到链表头部，下次分配最先被取走 */
+    pcp->count++;
+    zone_stat_inc(zone, free, 0);
+    if (pcp->count >= pcp->high)
+        pcp->count -= free_pages_bulk(zone, pcp->batch, pcp);
+    local_irq_restore(flags);
+    if (memory_pressure > NR_CPUS) /* 见memory_pressure值含义解释 */
+        memory_pressure--;
+}
+
+/* 释放一个“热”的0阶页面（其内容很可能还在cpu缓存中），参数：
+page：要释放的页面 */
+void free_hot_page(struct page *page)
+{
+    free_hot_cold_page(page, 0);
+}
+
+/* 释放一个“冷”的0阶页面，参数：
+page：要释放的页面 */
+void free_cold_page(struct page *page)
+{
+    free_hot_cold_page(page, 1);
+}
+
 /* 检查页面满足可以释放的条件后释放页面, 参数：
 page：释放的内存页的 struct page 结构的指针
 order：要释放的内存页的大小，以 2 的幂为单位 */
@@ -389,8 +1137,28 @@ void __free_pages(struct page *page, unsigned long order)
 {
     /* 检查页面是否设置了reserved和尝试减少页面的引用计数，并测试是否变为零 */
     if (!PageReserved(page) && put_page_testzero(page))
+    {
         /* 进来if，说明页面没有设定reserved和引用计数为0，那么就可以释放 */
-        __free_pages_ok(page, order); /* 释放页面，并尝试合并成更大块 */
+        if (order == 0)
+            free_hot_page(page); /* 单个页面放入本cpu的冷热页缓存 */
+        else
+            __free_pages_ok(page, order); /* 释放页面，并尝试合并成更大块 */
+    }
+}
+
+/* 通过虚拟地址释放2的order次方个连续页面，参数：
+addr：要释放的页面的虚拟地址
+order：要释放的页面数，以 2 的幂为单位 */
+void free_pages(unsigned long addr, unsigned long order)
+{
+    struct page *fpage;
+
+    if (addr != 0)
+    {
+        fpage = virt_to_page(addr);
+        if (VALID_PAGE(fpage))
+            __free_pages(fpage, order);
+    }
 }
 
 /* 遍历系统中的每个节点和每个节点中的内存区域，来计算系统中所有空闲页面的总数 */
@@ -405,8 +1173,142 @@ unsigned int nr_free_pages(void)
     {
         /*  在当前节点内，遍历所有内存区域（zone） */
         for (zone = pgdat->node_zones; zone < pgdat->node_zones + MAX_NR_ZONES; zone++)
+        {
+            int cpu, i;
+
             sum += zone->free_pages; /* 累加当前内存区域中的空闲页面数到 sum */
+            /* 冷热页缓存中的页面不计入zone->free_pages，但它们同样是空闲的 */
+            for (cpu = 0; cpu < NR_CPUS; cpu++)
+                for (i = 0; i < 2; i++)
+                    sum += zone->pageset[cpu].pcp[i].count;
+        }
         pgdat = pgdat->node_next;    /*  移动到下一个节点 */
     }
     return sum; /*  函数返回累加后的空闲页面总数 */
+}
+
+/* 打印每个内存节点每个zone的伙伴系统统计计数，包括水位线、冷热页缓存与锁的使用情况，
+以及每个阶的分配、释放、合并、拆分、触及水位线与失败次数 */
+void show_zone_stats(void)
+{
+    pg_data_t *pgdat;
+    zone_t *zone;
+    int order;
+
+    for (pgdat = pgdat_list; pgdat; pgdat = pgdat->node_next)
+    {
+        for (zone = pgdat->node_zones; zone < pgdat->node_zones + MAX_NR_ZONES; zone++)
+        {
+            zone_stat_t *st = &zone->stat;
+
+            if (!zone->size) /* 没有页面的zone不打印 */
+                continue;
+            printk("Node %d, zone %8s: free %lu, min %lu, low %lu, high %lu\n",
+                   pgdat->node_id, zone->name, zone->free_pages,
+                   zone->pages_min, zone->pages_low, zone->pages_high);
+            printk("  lock %lu, pcp refill %lu, pcp drain %lu, pageblock steal %lu\n",
+                   st->lock, st->pcp_refill, st->pcp_drain, st->pageblock_steal);
+            printk("  order    alloc     free    merge    split   wm_low   wm_min     fail fallback\n");
+            for (order = 0; order < MAX_ORDER; order++)
+                printk("  %5d %8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu\n", order,
+                       st->alloc[order], st->free[order], st->merge[order], st->split[order],
+                       st->wmark_low[order], st->wmark_min[order], st->fail[order],
+                       st->fallback[order]);
+        }
+    }
+}
+
+/* 计算一个zone在order阶上的外部碎片指数（千分之一为单位），参数：
+nr_blocks：该zone每个阶上的空闲块数
+order：要评估的分配的阶
+返回：如果存在不小于order阶的空闲块，分配可以成功，返回-1000；
+否则返回0到1000之间的值，越接近0说明分配失败是因为空闲内存不足，
+越接近1000说明空闲内存足够，但都被切成了小块，分配失败是因为外部碎片 */
+static int fragmentation_index(unsigned long *nr_blocks, unsigned int order)
+{
+    unsigned long requested = 1UL << order; /* 本次分配需要的页面数 */
+    unsigned long free_pages = 0;           /* 空闲页面总数 */
+    unsigned long free_blocks = 0;          /* 空闲块总数 */
+    unsigned int i;
+    int index;
+
+    for (i = 0; i < MAX_ORDER; i++)
+    {
+        if (i >= order && nr_blocks[i]) /* 有足够大的块，分配可以成功 */
+            return -1000;
+        free_pages += nr_blocks[i] << i;
+        free_blocks += nr_blocks[i];
+    }
+    if (!free_blocks) /* 完全没有空闲页面，失败纯粹是因为内存不足 */
+        return 0;
+    /* 指数 = 1 - (1 + 空闲页面数/需要的页面数) / 空闲块数，只有一两个小块时结果会略小于0，按0处理 */
+    index = 1000 - (int)((1000 + free_pages * 1000 / requested) / free_blocks);
+    return index < 0 ? 0 : index;
+}
+
+/* 迁移类型的名字，用于打印 */
+static char *migratetype_names[MIGRATE_TYPES] = {"Unmovable", "Reclaimable", "Movable"};
+
+/* 遍历每个内存节点每个zone的每个阶的空闲链表，打印每个阶上的空闲块数（相当于/proc/buddyinfo），
+以及每个阶的外部碎片指数，用于诊断高阶分配（如gfporder较大的slab、页表）为什么失败。
+之后按迁移类型分别打印每个阶上的空闲块数与各类型拥有的pageblock数（相当于/proc/pagetypeinfo） */
+void show_buddyinfo(void)
+{
+    pg_data_t *pgdat;
+    zone_t *zone;
+    unsigned long nr_blocks[MAX_ORDER];                /* 每个阶上的空闲块数 */
+    unsigned long nr_type[MIGRATE_TYPES][MAX_ORDER];   /* 每种迁移类型每个阶上的空闲块数 */
+    unsigned long nr_pageblocks[MIGRATE_TYPES];        /* 每种迁移类型拥有的pageblock数 */
+    unsigned long flags, i;
+    int order, index, t;
+
+    for (pgdat = pgdat_list; pgdat; pgdat = pgdat->node_next)
+    {
+        for (zone = pgdat->node_zones; zone < pgdat->node_zones + MAX_NR_ZONES; zone++)
+        {
+            if (!zone->size) /* 没有页面的zone不打印 */
+                continue;
+
+            spin_lock_irqsave(&zone->lock, flags); /* 遍历空闲链表期间不能有人修改它们 */
+            for (order = 0; order < MAX_ORDER; order++)
+            {
+                nr_blocks[order] = 0;
+                for (t = 0; t < MIGRATE_TYPES; t++)
+                {
+                    struct list_head *head = &zone->free_area[order].free_list[t], *curr;
+
+                    nr_type[t][order] = 0;
+                    for (curr = memlist_next(head); curr != head; curr = memlist_next(curr))
+                        nr_type[t][order]++;
+                    nr_blocks[order] += nr_type[t][order];
+                }
+            }
+            for (t = 0; t < MIGRATE_TYPES; t++)
+                nr_pageblocks[t] = 0;
+            for (i = 0; i < (zone->size + pageblock_nr_pages - 1) >> pageblock_order; i++)
+                nr_pageblocks[zone->pageblock_type[i]]++;
+            spin_unlock_irqrestore(&zone->lock, flags);
+
+            printk("Node %d, zone %8s ", pgdat->node_id, zone->name);
+            for (order = 0; order < MAX_ORDER; order++)
+                printk("%6lu ", nr_blocks[order]);
+            printk("\nNode %d, zone %8s frag ", pgdat->node_id, zone->name);
+            for (order = 0; order < MAX_ORDER; order++)
+            {
+                index = fragmentation_index(nr_blocks, order);
+                if (index < 0)
+                    printk("%6s ", "-1"); /* 分配可以成功 */
+                else
+                    printk(" %d.%03d ", index / 1000, index % 1000);
+            }
+            printk("\n");
+            for (t = 0; t < MIGRATE_TYPES; t++)
+            {
+                printk("Node %d, zone %8s %-11s ", pgdat->node_id, zone->name, migratetype_names[t]);
+                for (order = 0; order < MAX_ORDER; order++)
+                    printk("%6lu ", nr_type[t][order]);
+                printk(" pageblocks %lu\n", nr_pageblocks[t]);
+            }
+        }
+    }
 }
\ No newline at end of file
@@ -1,9 +1,79 @@
 #include <linux/slab.h>
 #include <linux/interrupt.h>
 #include <linux/init.h>
+#include <asm-i386/semaphore.h>
 
 #define CACHE_NAMELEN 20 /* slab缓存池管理的对象名字长度 */
 
+/* 每个cpu在每个缓存池前面都有一个对象数组，最近释放的对象先放进数组，分配时先从数组末尾取，
+后进先出，取到的对象很可能还在cpu缓存中。数组空了或满了才成批地与slab交换对象，
+这时才需要获取缓存池的锁、遍历slab链表 */
+typedef struct cpucache_s
+{
+    unsigned int avail; /* 数组中现有的对象数 */
+    unsigned int limit; /* 数组最多能放的对象数 */
+} cpucache_t;
+
+/* 得到cpucache_t后面紧跟的对象指针数组 */
+#define cc_entry(cpucache) ((void **)(((cpucache_t *)(cpucache)) + 1))
+
+/* 得到当前cpu在缓存池前面的对象数组，NULL表示这个缓存池没有启用对象数组 */
+#define cc_data(cachep) ((cachep)->cpudata[smp_processor_id()])
+
+/* 对象数组最多能放的对象数，见enable_cpucache */
+#define CPUCACHE_MAX_LIMIT 252
+
+/* 对象大小与对齐的基本单位，一个机器字 */
+#define BYTES_PER_WORD sizeof(void *)
+
+/* 一个slab最多由2的MAX_GFP_ORDER次方个页面组成 */
+#define MAX_GFP_ORDER 5
+
+/* 对象最大不能超过2的MAX_OBJ_ORDER次方个页面 */
+#define MAX_OBJ_ORDER 5
+
+/* 物理内存超过32MB时，为了减少slab末尾的浪费，可以使用到MAX_GFP_ORDER阶的slab，
+否则连续的高阶页面很宝贵，slab的阶不超过BREAK_GFP_ORDER_LO */
+#define BREAK_GFP_ORDER_HI MAX_GFP_ORDER
+#define BREAK_GFP_ORDER_LO 1
+
+/* 计算slab的阶时，超过这个阶就不再增大，即使浪费的空间还比较多，除非更低的阶一个对象也放不下 */
+static unsigned int slab_break_gfp_order = BREAK_GFP_ORDER_LO;
+
+/* 对象不小于这个大小时，slab管理结构放到slab外面（CFLGS_OFF_SLAB），从slabp_cache中分配，
+slab的页面全部留给对象。一页只能放几个这样的对象，管理结构放在页面里常常要挤掉一个对象 */
+#define OFF_SLAB_MIN_SIZE (PAGE_SIZE >> 3)
+
+/* 缓存池的slab管理结构是否在slab外面 */
+#define OFF_SLAB(x) ((x)->flags & CFLGS_OFF_SLAB)
+
+/* off-slab的slab最多管理这么多对象，它的管理结构要能放进已经创建好的、管理结构在slab中的最大的kmalloc缓存池，
+在kmem_cache_sizes_init中随着kmalloc缓存池的创建而增大，为0时还不能使用off-slab */
+static unsigned long offslab_limit;
+
+/* 调试用的缓存池标志 */
+#define SLAB_DEBUG_FLAGS (SLAB_DEBUG_FREE | SLAB_STORE_USER | SLAB_RED_ZONE | SLAB_POISON)
+
+/* kmem_cache_create允许调用者传入的缓存池标志 */
+#define CREATE_MASK (SLAB_HWCACHE_ALIGN | SLAB_NO_REAP | SLAB_CACHE_DMA | SLAB_RECLAIM_ACCOUNT | SLAB_DEBUG_FLAGS)
+
+#ifdef CONFIG_DEBUG_SLAB
+/* 空闲对象红区中的魔数 */
+#define RED_MAGIC1 0x5A2CF071UL
+
+/* 已分配对象红区中的魔数 */
+#define RED_MAGIC2 0x170FC2A5UL
+
+/* 空闲对象中填充的毒化字节 */
+#define POISON_BYTE 0x5a
+
+/* 毒化区域最后一个字节，用于发现从对象末尾往外的越界写 */
+#define POISON_END 0xa5
+#endif
+
+/* kmem_cache_t的dflags的值，表示缓存池最近增长过 */
+#define DFLGS_GROWN 0x000001UL
+
 /* 对 SLAB 缓存池的抽象，其实例代表一类特定类型的对象（如 task_struct）。
 每个slab缓存池内有大量的slab，然后每个slab会被划分成固定大小的区域用于固定大小的内存分配，
 如task_struct的分配 */
@@ -32,8 +102,44 @@ struct kmem_cache_s
     unsigned long failures;   /* 记录缓存分配失败的次数 */
     char name[CACHE_NAMELEN]; /* 缓存的名称 */
     struct list_head next;    /* 将这个缓存池结构链接到全局缓存池链表 */
+    cpucache_t *cpudata[NR_CPUS]; /* 每个cpu的对象数组 */
+    unsigned int batchcount;      /* 对象数组与slab之间每批交换的对象数 */
+    /* 统计计数，见show_slabinfo */
+    unsigned long num_active;      /* 调用者手中的对象数，不含每个cpu对象数组中的对象 */
+    unsigned long high_mark;       /* num_active曾经达到的最大值 */
+    unsigned long num_allocations; /* 分配对象的次数 */
+    unsigned long num_frees;       /* 释放对象的次数 */
+    unsigned long grown;           /* 增长slab的次数 */
+    unsigned long reaped;          /* 被kmem_cache_reap回收的slab数 */
+    unsigned long errors;          /* 增长slab失败的总次数，failures在增长成功后会清零 */
+    unsigned long allochit;        /* 直接从对象数组中分配的次数 */
+    unsigned long allocmiss;       /* 对象数组为空，需要从slab成批取对象的次数 */
+    unsigned long freehit;         /* 直接放进对象数组的释放次数 */
+    unsigned long freemiss;        /* 对象数组已满，需要成批还给slab的释放次数 */
 };
 
+/* 更新缓存池统计计数的宏，调用者已经关了中断 */
+#define STATS_INC_ALLOCED(x)                       \
+    do                                             \
+    {                                              \
+        (x)->num_allocations++;                    \
+        if (++(x)->num_active > (x)->high_mark)    \
+            (x)->high_mark = (x)->num_active;      \
+    } while (0)
+#define STATS_INC_FREED(x) \
+    do                     \
+    {                      \
+        (x)->num_frees++;  \
+        (x)->num_active--; \
+    } while (0)
+#define STATS_INC_GROWN(x) ((x)->grown++)
+#define STATS_INC_REAPED(x) ((x)->reaped++)
+#define STATS_INC_ERR(x) ((x)->errors++)
+#define STATS_INC_ALLOCHIT(x) ((x)->allochit++)
+#define STATS_INC_ALLOCMISS(x) ((x)->allocmiss++)
+#define STATS_INC_FREEHIT(x) ((x)->freehit++)
+#define STATS_INC_FREEMISS(x) ((x)->freemiss++)
+
 /* 创建了一个叫cache_cache的slab缓存池，并进行了初始化
 它用于管理所有的slab缓存池，也就是管理其他的kmem_cache_t 结构体 */
 static kmem_cache_t cache_cache = {
@@ -44,6 +150,7 @@ static kmem_cache_t cache_cache = {
     .spinlock = SPIN_LOCK_UNLOCKED,
     .colour_off = L1_CACHE_BYTES,
     .name = "kmem_cache",
+    .next = LIST_HEAD_INIT(cache_cache.next),
 };
 
 /* 信号量，用于操作slab缓存池 */
@@ -52,8 +159,88 @@ static struct semaphore cache_chain_sem;
 /* 用于访问总slab缓存池的下一个，也就是第一个真正用于资源管理的slab缓存池 */
 #define cache_chain (cache_cache.next)
 
+/* 回收时从这个缓存池开始扫描，每次回收后移到扫描停下的位置，像时钟指针一样轮流照顾每个缓存池 */
+static kmem_cache_t *clock_searchp = &cache_cache;
+
+/* 一次回收最多扫描这么多个缓存池 */
+#define REAP_SCANLEN 10
+
+/* 扫描到有这么多全空slab的缓存池就不再往下找，直接回收它 */
+#define REAP_PERFECT 10
+
+/* 管理每个cpu对象数组的缓存池，数组本身也是slab对象 */
+static kmem_cache_t *cpucache_cachep;
+
+/* 对象数组是否已经可以使用，在此之前创建的缓存池由kmem_cpucache_init统一启用 */
+static int g_cpucache_up;
+
+static void enable_cpucache(kmem_cache_t *cachep);
+
+/* kmalloc的一个大小级别，分别有普通的与DMA区域的缓存池 */
+typedef struct cache_sizes
+{
+    size_t cs_size;              /* 这一级对象的大小 */
+    kmem_cache_t *cs_cachep;     /* 普通缓存池 */
+    kmem_cache_t *cs_dmacachep;  /* 从DMA区域分配的缓存池 */
+} cache_sizes_t;
+
+/* kmalloc最小的对象是2的KMALLOC_MIN_SHIFT次方字节，之后每一级大小翻倍 */
+#define KMALLOC_MIN_SHIFT 5
+
+/* kmalloc的大小级别，从32字节到128KB，以大小为0的一项结尾。
+128KB的对象正好占满2的MAX_GFP_ORDER次方个页面，slab_t只能放到slab外面 */
+static cache_sizes_t cache_sizes[] = {
+    {32, NULL, NULL},
+    {64, NULL, NULL},
+    {128, NULL, NULL},
+    {256, NULL, NULL},
+    {512, NULL, NULL},
+    {1024, NULL, NULL},
+    {2048, NULL, NULL},
+    {4096, NULL, NULL},
+    {8192, NULL, NULL},
+    {16384, NULL, NULL},
+    {32768, NULL, NULL},
+    {65536, NULL, NULL},
+    {131072, NULL, NULL},
+    {0, NULL, NULL}};
+
+/* 各个大小级别的缓存池名字，与cache_sizes一一对应 */
+static const char *cache_names[][2] = {
+    {"size-32", "size-32(DMA)"},
+    {"size-64", "size-64(DMA)"},
+    {"size-128", "size-128(DMA)"},
+    {"size-256", "size-256(DMA)"},
+    {"size-512", "size-512(DMA)"},
+    {"size-1024", "size-1024(DMA)"},
+    {"size-2048", "size-2048(DMA)"},
+    {"size-4096", "size-4096(DMA)"},
+    {"size-8192", "size-8192(DMA)"},
+    {"size-16384", "size-16384(DMA)"},
+    {"size-32768", "size-32768(DMA)"},
+    {"size-65536", "size-65536(DMA)"},
+    {"size-131072", "size-131072(DMA)"}};
+
+/* kmalloc能分配的最大对象 */
+#define KMALLOC_MAX_SIZE 131072
+
+/* 由对象大小直接算出它属于cache_sizes中的哪一级，而不是从小到大逐级比较：
+大于32字节的对象，size-1的最高位决定了能容纳它的最小的2的幂，参数：
+size：对象的大小，不超过KMALLOC_MAX_SIZE */
+static inline int kmalloc_index(size_t size)
+{
+    if (size <= (1 << KMALLOC_MIN_SHIFT))
+        return 0;
+    return fls(size - 1) - KMALLOC_MIN_SHIFT;
+}
+
+/* slab中每个对象对应一个kmem_bufctl_t，对象空闲时它记录下一个空闲对象的序号，
+所有空闲对象就这样串成一条链，链头是slab_t的free */
 typedef unsigned int kmem_bufctl_t;
 
+/* 空闲对象链的结尾 */
+#define BUFCTL_END 0xffffFFFF
+
 /* 一个内存 slab 的抽象 */
 typedef struct slab_s
 {
@@ -73,6 +260,16 @@ typedef struct slab_s
 /* 规定了一个slab内可供固定分配的内存区域大小的上限 */
 #define SLAB_LIMIT 0xffffFFFE
 
+/* 得到slab的kmem_bufctl_t数组，它紧跟在slab_t之后 */
+#define slab_bufctl(slabp) ((kmem_bufctl_t *)(((slab_t *)slabp) + 1))
+
+/* 页面分配给slab之后，它的list字段不再用于伙伴系统，list.next记录页面属于哪个缓存池，
+list.prev记录页面属于哪个slab，释放对象时由对象地址找到页面，再找到slab与缓存池 */
+#define SET_PAGE_CACHE(pg, x) ((pg)->list.next = (struct list_head *)(x))
+#define GET_PAGE_CACHE(pg) ((kmem_cache_t *)(pg)->list.next)
+#define SET_PAGE_SLAB(pg, x) ((pg)->list.prev = (struct list_head *)(x))
+#define GET_PAGE_SLAB(pg) ((slab_t *)(pg)->list.prev)
+
 /* 计算在给定空间大小下，这个slab能够存放多少个
 固定大小的区域（考虑到缓存对齐和额外开销）。参数：
 gfporder 表示分配的页面数量（以 2 的幂次表示），
@@ -82,7 +279,7 @@ left_over 用于存储剩余空间大小的指针，
 num 是存储每页可以放置对象数量的指针 */
 static void kmem_cache_estimate(unsigned long gfporder, size_t size, int flags, size_t *left_over, unsigned int *num)
 {
-    int i;                                  /* 用于循环 */
+    unsigned int i;                         /* 能放下的对象数 */
     size_t wastage = PAGE_SIZE << gfporder; /* 计算总可用空间大小 */
     size_t extra = 0;                       /* 计算每个缓存对象额外的开销 */
     size_t base = 0;                        /* 计算每个slab的基本开销 */
@@ -93,12 +290,12 @@ static void kmem_cache_estimate(unsigned long gfporder, size_t size, int flags,
         base = sizeof(slab_t);         /* 计算每个slab的基本开销 */
         extra = sizeof(kmem_bufctl_t); /* slab管理的每个对象都需要一个kmem_bufctl_t */
     }
-    i = 0;
-    /* 计算可以放入给定内存空间的缓存对象的最大数量，
-    L1_CACHE_ALIGN 用于确保内存对齐，以优化 CPU 缓存的效率 */
-    while (i * size + L1_CACHE_ALIGN(base + i * extra) <= wastage)
-        i++;
-    if (i > 0) /* 上面循环结束i会比真实能放入数量大1，这里对 i 进行调整 */
+    /* 不考虑对齐时，每个对象连同它的kmem_bufctl_t占size + extra字节，直接除出对象数，
+    而不是从0开始逐个试探，小对象在高阶slab中要试探上千次 */
+    i = (wastage - base) / (size + extra);
+    /* L1_CACHE_ALIGN 用于确保内存对齐，以优化 CPU 缓存的效率，
+    对齐最多多占L1_CACHE_BYTES - 1字节，减掉几个对象就能放下 */
+    while (i > 0 && i * size + L1_CACHE_ALIGN(base + i * extra) > wastage)
         i--;
 
     if (i > SLAB_LIMIT)
@@ -110,6 +307,43 @@ static void kmem_cache_estimate(unsigned long gfporder, size_t size, int flags,
     *left_over = wastage;                        /* 将剩余空间赋值给left_over指针 */
 }
 
+/* slab末尾浪费的空间不超过slab大小的1/SLAB_WASTE_RATIO，就认为这个布局可以接受 */
+#define SLAB_WASTE_RATIO 8
+
+/* 为缓存池选择slab的阶：依次估算0到MAX_GFP_ORDER阶的slab能放下多少对象、浪费多少空间，
+取浪费不超过1/SLAB_WASTE_RATIO的最低的阶；没有一个阶满足，就取浪费比例最小的阶，比例相同时取低的阶。
+阶越高，向伙伴系统申请连续页面越难，所以只要浪费可以接受就不再往上找，也不超过slab_break_gfp_order，参数：
+cachep：缓存池，结果放在它的gfporder与num中
+size：对齐之后的对象大小
+flags：缓存池标志，决定slab管理结构是否放在slab中
+left_over：存放选定的slab末尾浪费的字节数 */
+static void kmem_cache_plan(kmem_cache_t *cachep, size_t size, unsigned long flags, size_t *left_over)
+{
+    unsigned int order, num;
+    size_t waste;
+
+    cachep->num = 0;
+    for (order = 0; order <= MAX_GFP_ORDER; order++)
+    {
+        if (order > slab_break_gfp_order && cachep->num)
+            break;
+        kmem_cache_estimate(order, size, flags, &waste, &num);
+        if (!num) /* 一个对象也放不下 */
+            continue;
+        if ((flags & CFLGS_OFF_SLAB) && num > offslab_limit) /* 管理结构没有缓存池能放下，阶不能再高了 */
+            break;
+        /* 比较浪费比例waste / (PAGE_SIZE << order)，交叉相乘避免除法 */
+        if (!cachep->num || waste * (PAGE_SIZE << cachep->gfporder) < *left_over * (PAGE_SIZE << order))
+        {
+            cachep->gfporder = order;
+            cachep->num = num;
+            *left_over = waste;
+        }
+        if (waste * SLAB_WASTE_RATIO <= (PAGE_SIZE << order)) /* 可以接受的浪费 */
+            break;
+    }
+}
+
 /* 初始化 slab 分配器: 核心就是初始化了cache_cache（总slab缓存池，
 管理所有的slab缓存池，也就是kmem_cache_t结构体的分配） */
 void __init kmem_cache_init(void)
@@ -121,7 +355,1151 @@ void __init kmem_cache_init(void)
     kmem_cache_estimate(0, cache_cache.objsize, 0, &left_over, &cache_cache.num);
     if (!cache_cache.num) /* 如果一页放不下一个cache_cache.num，那么报错 */
         BUG();
+    cache_cache.colour_off = cache_line_size();               /* 着色偏移量取运行时检测到的缓存行大小 */
     cache_cache.colour = left_over / cache_cache.colour_off; /* 计算“颜色”（colouring）的数量 */
     /* 初始化 colour_next，这是用于跟踪下一个分配应使用的颜色偏移的变量 */
     cache_cache.colour_next = 0;
-}
\ No newline at end of file
+}
+
+/* 创建kmalloc使用的各个大小的通用缓存池，在mem_init之后调用 */
+void __init kmem_cache_sizes_init(void)
+{
+    cache_sizes_t *sizes = cache_sizes;
+    const char *(*names)[2] = cache_names;
+
+    /* 物理内存大于32MB时，允许slab使用更高阶的页面块，以减少每个slab末尾浪费的空间。
+    num_physpages在mem_init中才计算出来 */
+    if (num_physpages > (32 << 20) >> PAGE_SHIFT)
+        slab_break_gfp_order = BREAK_GFP_ORDER_HI;
+
+    do
+    {
+        sizes->cs_cachep = kmem_cache_create((*names)[0], sizes->cs_size, 0, SLAB_HWCACHE_ALIGN, NULL, NULL);
+        if (!sizes->cs_cachep)
+            BUG();
+        /* 大小从小到大创建，后面off-slab的缓存池的管理结构可以从前面的缓存池中分配，
+        但这个缓存池自己的管理结构不能在slab外面，否则可能要从自己中分配 */
+        if (!OFF_SLAB(sizes->cs_cachep))
+            offslab_limit = (sizes->cs_size - sizeof(slab_t)) / sizeof(kmem_bufctl_t);
+        sizes->cs_dmacachep = kmem_cache_create((*names)[1], sizes->cs_size, 0,
+                                                SLAB_CACHE_DMA | SLAB_HWCACHE_ALIGN, NULL, NULL);
+        if (!sizes->cs_dmacachep)
+            BUG();
+        sizes++;
+        names++;
+    } while (sizes->cs_size);
+}
+
+/* 从伙伴系统中为一个slab分配页面，参数：
+cachep：slab所属的缓存池
+flags：分配标志
+返回：页面块的虚拟地址，失败返回NULL */
+static inline void *kmem_getpages(kmem_cache_t *cachep, unsigned long flags)
+{
+    flags |= cachep->gfpflags; /* 加上缓存池自己的GFP掩码，如DMA与可回收 */
+    return (void *)__get_free_pages(flags, cachep->gfporder);
+}
+
+/* 把一个slab的页面还给伙伴系统，参数：
+cachep：slab所属的缓存池
+addr：页面块的虚拟地址 */
+static inline void kmem_freepages(kmem_cache_t *cachep, void *addr)
+{
+    unsigned long i = (1 << cachep->gfporder);
+    struct page *page = virt_to_page(addr);
+
+    while (i--) /* 页面不再属于slab */
+    {
+        PageClearSlab(page);
+        page++;
+    }
+    free_pages((unsigned long)addr, cachep->gfporder);
+}
+
+/* 创建一个slab缓存池，参数：
+name：缓存池的名字
+size：对象的大小
+offset：着色偏移量的对齐要求，0表示使用默认值
+flags：缓存池标志，见CREATE_MASK
+ctor、dtor：对象的构造与析构函数，可以为NULL
+返回：创建好的缓存池，失败返回NULL */
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t offset, unsigned long flags,
+                                void (*ctor)(void *, kmem_cache_t *, unsigned long),
+                                void (*dtor)(void *, kmem_cache_t *, unsigned long))
+{
+    const char *func_nm = "kmem_create: "; /* 报错信息的前缀 */
+    size_t left_over, align, slab_size;
+    unsigned int on_num = 0, on_order = 0;
+    kmem_cache_t *cachep = NULL;
+    int i;
+
+    /* 参数检查：名字要能放进name字段，对象至少一个字、最多2的MAX_OBJ_ORDER次方个页面，
+    有析构函数就必须有构造函数，着色偏移不能超过对象大小 */
+    if ((!name) || (strnlen(name, CACHE_NAMELEN) >= CACHE_NAMELEN) || (size < BYTES_PER_WORD) ||
+        (size > (1 << MAX_OBJ_ORDER) * PAGE_SIZE) || (dtor && !ctor) || (offset > size))
+        BUG();
+
+    if (flags & ~CREATE_MASK) /* 不认识的标志 */
+        BUG();
+
+#ifdef CONFIG_DEBUG_SLAB
+    /* 调试模式下所有缓存池都打开红区、毒化与调用者记录。SLAB_DEBUG_FREE要调用者自己要求：
+    它让缓存池不使用每个cpu的对象数组，强制打开会让调试内核的每次分配释放都走到slab。
+    没有它，带红区的对象被重复释放时仍然能发现。有构造函数的对象在空闲时也保持构造好的状态，不能毒化 */
+    flags |= SLAB_DEBUG_FLAGS & ~SLAB_DEBUG_FREE;
+    if (ctor)
+        flags &= ~SLAB_POISON;
+    /* 大对象不加红区与调用者记录，多出来的几个字会让对象再也不能整齐地排满页面 */
+    if (size >= OFF_SLAB_MIN_SIZE)
+        flags &= ~(SLAB_RED_ZONE | SLAB_STORE_USER);
+#else
+    flags &= ~SLAB_DEBUG_FLAGS;
+#endif
+
+    /* 缓存池的描述符本身也是从cache_cache中分配的对象 */
+    cachep = (kmem_cache_t *)kmem_cache_alloc(&cache_cache, SLAB_KERNEL);
+    if (!cachep)
+        goto opps;
+    memset(cachep, 0, sizeof(kmem_cache_t));
+
+    /* 对象大小向上对齐到一个字，保证对象的地址都是字对齐的 */
+    if (size & (BYTES_PER_WORD - 1))
+    {
+        size += (BYTES_PER_WORD - 1);
+        size &= ~(BYTES_PER_WORD - 1);
+        printk("%sForcing size word alignment - %s\n", func_nm, name);
+    }
+
+#ifdef CONFIG_DEBUG_SLAB
+    if (flags & SLAB_RED_ZONE)
+    {
+        /* 对象前后各加一个字的红区，调用者拿到的对象从第一个红区之后开始，不能再按缓存行对齐 */
+        flags &= ~SLAB_HWCACHE_ALIGN;
+        size += 2 * BYTES_PER_WORD;
+    }
+    if (flags & SLAB_STORE_USER)
+        size += BYTES_PER_WORD; /* 对象最后一个字记录调用者 */
+#endif
+
+    align = BYTES_PER_WORD;
+    if (flags & SLAB_HWCACHE_ALIGN)
+        align = L1_CACHE_BYTES;
+
+    if (flags & SLAB_HWCACHE_ALIGN)
+    {
+        /* 小对象不必独占一整条缓存行，对齐值减半直到对象大于对齐值的一半，
+        这样一条缓存行里能放下整数个对象，每个对象仍不会跨越缓存行 */
+        while (size < align / 2)
+            align /= 2;
+        size = (size + align - 1) & (~(align - 1));
+    }
+
+    if (size >= OFF_SLAB_MIN_SIZE && offslab_limit)
+    {
+        /* 先按管理结构放在slab中规划一次，只是为了报告off-slab多放下了多少对象 */
+        kmem_cache_plan(cachep, size, flags, &left_over);
+        on_num = cachep->num;
+        on_order = cachep->gfporder;
+        flags |= CFLGS_OFF_SLAB;
+    }
+
+    kmem_cache_plan(cachep, size, flags, &left_over); /* 选择slab的阶 */
+
+    if (!cachep->num) /* 最大的slab也放不下一个对象 */
+    {
+        printk("kmem_cache_create: couldn't create cache %s.\n", name);
+        kmem_cache_free(&cache_cache, cachep);
+        cachep = NULL;
+        goto opps;
+    }
+    slab_size = L1_CACHE_ALIGN(cachep->num * sizeof(kmem_bufctl_t) + sizeof(slab_t));
+
+    if ((flags & CFLGS_OFF_SLAB) && left_over >= slab_size)
+    {
+        /* slab末尾剩下的空间放得下管理结构，就不必放到外面，省一次分配 */
+        flags &= ~CFLGS_OFF_SLAB;
+        left_over -= slab_size;
+    }
+    /* 着色偏移量至少按对象的对齐值对齐，不同的slab把第一个对象放在不同的偏移上，
+    让不同slab中相同序号的对象落在不同的cpu缓存行组中。slab末尾浪费的空间有多少个偏移量，就有多少种颜色。
+    默认偏移量是启动时检测到的缓存行大小，而不是编译时的L1_CACHE_BYTES：缓存行比它大时，
+    相邻的两种颜色落在同一条缓存行里，颜色数多了一倍，错开的缓存组却没有增加 */
+    if (!offset)
+        offset = cache_line_size();
+    offset += (align - 1);
+    offset &= ~(align - 1);
+    cachep->colour_off = offset;
+    cachep->colour = left_over / offset;
+    printk("slab: %-16s objsize %5u order %u %4u objs/slab %3u colours %5u bytes wasted\n",
+           name, size, cachep->gfporder, cachep->num, cachep->colour, left_over);
+
+    if (flags & CFLGS_OFF_SLAB)
+    {
+        unsigned int off_pp = (cachep->num * 100) >> cachep->gfporder; /* 每页对象数的100倍 */
+        unsigned int on_pp = (on_num * 100) >> on_order;
+
+        cachep->slabp_cache = kmem_find_general_cachep(slab_size, 0);
+        printk("slab: %-16s off-slab, %u.%02u objs/page (on-slab %u.%02u)\n",
+               name, off_pp / 100, off_pp % 100, on_pp / 100, on_pp % 100);
+    }
+
+    cachep->flags = flags;
+    cachep->gfpflags = 0;
+    if (flags & SLAB_CACHE_DMA)
+        cachep->gfpflags |= GFP_DMA;
+    if (flags & SLAB_RECLAIM_ACCOUNT)
+        cachep->gfpflags |= __GFP_RECLAIMABLE;
+    cachep->spinlock = SPIN_LOCK_UNLOCKED;
+    cachep->objsize = size;
+    INIT_LIST_HEAD(&cachep->slabs);
+    cachep->firstnotfull = &cachep->slabs;
+    cachep->ctor = ctor;
+    cachep->dtor = dtor;
+    for (i = 0; name[i]; i++) /* 上面已经检查过名字的长度 */
+        cachep->name[i] = name[i];
+    cachep->name[i] = '\0';
+
+    /* 挂到全局缓存池链表上 */
+    down(&cache_chain_sem);
+    list_add(&cachep->next, &cache_chain);
+    up(&cache_chain_sem);
+    if (g_cpucache_up)
+        enable_cpucache(cachep);
+opps:
+    return cachep;
+}
+
+/* 初始化一个新slab的管理结构，slab_t后面紧跟kmem_bufctl_t数组。
+管理结构在slab中时放在slab页面的开头（着色偏移之后），再往后才是对象；
+在slab外面时从slabp_cache中分配，对象从着色偏移处开始，参数：
+cachep：slab所属的缓存池
+objp：slab页面块的起始虚拟地址
+colour_off：这个slab的着色偏移
+local_flags：分配off-slab管理结构的标志
+返回：slab_t，分配不到off-slab管理结构时返回NULL */
+static inline slab_t *kmem_cache_slabmgmt(kmem_cache_t *cachep, void *objp, int colour_off, int local_flags)
+{
+    slab_t *slabp;
+
+    if (OFF_SLAB(cachep))
+    {
+        slabp = kmem_cache_alloc(cachep->slabp_cache, local_flags);
+        if (!slabp)
+            return NULL;
+    }
+    else
+    {
+        slabp = objp + colour_off;
+        colour_off += L1_CACHE_ALIGN(cachep->num * sizeof(kmem_bufctl_t) + sizeof(slab_t));
+    }
+    slabp->inuse = 0;
+    slabp->colouroff = colour_off;
+    slabp->s_mem = objp + colour_off;
+    return slabp;
+}
+
+#ifdef CONFIG_DEBUG_SLAB
+/* 调试模式下一个对象在slab中的布局：
+[红区1][调用者看到的对象][红区2][最后的调用者]，红区与调用者记录各占一个字，按缓存池的标志可以没有 */
+
+/* 调用者看到的对象相对于slab中对象起始地址的偏移 */
+static inline unsigned int dbg_obj_offset(kmem_cache_t *cachep)
+{
+    return (cachep->flags & SLAB_RED_ZONE) ? BYTES_PER_WORD : 0;
+}
+
+/* 调用者看到的对象大小 */
+static inline unsigned int dbg_obj_size(kmem_cache_t *cachep)
+{
+    unsigned int size = cachep->objsize;
+
+    if (cachep->flags & SLAB_RED_ZONE)
+        size -= 2 * BYTES_PER_WORD;
+    if (cachep->flags & SLAB_STORE_USER)
+        size -= BYTES_PER_WORD;
+    return size;
+}
+
+/* 对象前面的红区，objp是slab中对象的起始地址 */
+static inline unsigned long *dbg_redzone1(void *objp)
+{
+    return (unsigned long *)objp;
+}
+
+/* 对象后面的红区 */
+static inline unsigned long *dbg_redzone2(kmem_cache_t *cachep, void *objp)
+{
+    return (unsigned long *)(objp + BYTES_PER_WORD + dbg_obj_size(cachep));
+}
+
+/* 记录最后的调用者的字，是对象的最后一个字 */
+static inline void **dbg_userword(kmem_cache_t *cachep, void *objp)
+{
+    return (void **)(objp + cachep->objsize - BYTES_PER_WORD);
+}
+
+/* 给空闲对象填上毒化字节，最后一个字节用另一个值，参数：
+cachep：缓存池
+objp：slab中对象的起始地址 */
+static void kmem_poison_obj(kmem_cache_t *cachep, void *objp)
+{
+    unsigned int size = dbg_obj_size(cachep);
+
+    objp += dbg_obj_offset(cachep);
+    memset(objp, POISON_BYTE, size);
+    *(unsigned char *)(objp + size - 1) = POISON_END;
+}
+
+/* 检查空闲对象的毒化字节有没有被改写，返回第一个被改写的字节的地址，没有被改写返回NULL */
+static void *kmem_check_poison_obj(kmem_cache_t *cachep, void *objp)
+{
+    unsigned int size = dbg_obj_size(cachep);
+    unsigned char *p = objp + dbg_obj_offset(cachep);
+    unsigned int i;
+
+    for (i = 0; i < size - 1; i++)
+        if (p[i] != POISON_BYTE)
+            return p + i;
+    if (p[size - 1] != POISON_END)
+        return p + size - 1;
+    return NULL;
+}
+
+/* 报告对象被破坏，然后停机，参数：
+cachep：对象所属的缓存池
+objp：slab中对象的起始地址
+msg：错误描述
+caller：这次分配或释放的调用者 */
+static void kmem_debug_error(kmem_cache_t *cachep, void *objp, const char *msg, void *caller)
+{
+    printk("slab error in cache `%s': %s, object %p, caller %p", cachep->name, msg,
+           objp + dbg_obj_offset(cachep), caller);
+    if (cachep->flags & SLAB_STORE_USER)
+        printk(", last user %p", *dbg_userword(cachep, objp));
+    printk("\n");
+    BUG();
+}
+
+/* 对象从缓存池交给调用者之前的检查：毒化字节没有被改写（没有人在释放后继续写它），
+两个红区都是空闲的魔数（对象没有被分配两次，相邻对象也没有越界写到这里），参数：
+cachep：缓存池
+objp：slab中对象的起始地址
+caller：分配的调用者
+返回：调用者看到的对象地址 */
+static void *kmem_debug_alloc(kmem_cache_t *cachep, void *objp, void *caller)
+{
+    if ((cachep->flags & SLAB_POISON) && kmem_check_poison_obj(cachep, objp))
+        kmem_debug_error(cachep, objp, "object modified after free", caller);
+    if (cachep->flags & SLAB_RED_ZONE)
+    {
+        if (*dbg_redzone1(objp) != RED_MAGIC1 || *dbg_redzone2(cachep, objp) != RED_MAGIC1)
+            kmem_debug_error(cachep, objp, "red zone overwritten or object allocated twice", caller);
+        *dbg_redzone1(objp) = *dbg_redzone2(cachep, objp) = RED_MAGIC2;
+    }
+    if (cachep->flags & SLAB_STORE_USER)
+        *dbg_userword(cachep, objp) = caller;
+    return objp + dbg_obj_offset(cachep);
+}
+
+/* 对象还给缓存池之前的检查：它确实是这个缓存池某个slab中的对象，两个红区都是已分配的魔数
+（没有越界写，也不是第二次释放），然后毒化对象，参数：
+cachep：缓存池
+objp：调用者传入的对象地址
+caller：释放的调用者
+返回：slab中对象的起始地址 */
+static void *kmem_debug_free(kmem_cache_t *cachep, void *objp, void *caller)
+{
+    struct page *page = virt_to_page(objp);
+    slab_t *slabp;
+
+    objp -= dbg_obj_offset(cachep);
+    if (!PageSlab(page) || GET_PAGE_CACHE(page) != cachep)
+        kmem_debug_error(cachep, objp, "object does not belong to this cache", caller);
+    slabp = GET_PAGE_SLAB(page);
+    if (objp < slabp->s_mem || (objp - slabp->s_mem) % cachep->objsize)
+        kmem_debug_error(cachep, objp, "pointer is not the start of an object", caller);
+    if (cachep->flags & SLAB_RED_ZONE)
+    {
+        if (*dbg_redzone1(objp) == RED_MAGIC1 && *dbg_redzone2(cachep, objp) == RED_MAGIC1)
+            kmem_debug_error(cachep, objp, "double free", caller);
+        if (*dbg_redzone1(objp) != RED_MAGIC2 || *dbg_redzone2(cachep, objp) != RED_MAGIC2)
+            kmem_debug_error(cachep, objp, "red zone overwritten", caller);
+        *dbg_redzone1(objp) = *dbg_redzone2(cachep, objp) = RED_MAGIC1;
+    }
+    if (cachep->flags & SLAB_STORE_USER)
+        *dbg_userword(cachep, objp) = caller;
+    if (cachep->flags & SLAB_POISON)
+        kmem_poison_obj(cachep, objp);
+    return objp;
+}
+#endif /* CONFIG_DEBUG_SLAB */
+
+/* 把新slab中所有对象串成空闲对象链，第i个对象的下一个空闲对象是第i+1个，
+缓存池有构造函数时在这里构造每一个对象。对象只在slab增长时构造一次，之后调用者释放对象时要把它恢复成构造好的状态，
+下一次分配直接拿去用，省掉了每次分配时的初始化，参数：
+cachep：slab所属的缓存池
+slabp：新的slab
+ctor_flags：传给构造函数的标志，见SLAB_CTOR_CONSTRUCTOR */
+static inline void kmem_cache_init_objs(kmem_cache_t *cachep, slab_t *slabp, unsigned long ctor_flags)
+{
+    unsigned int i;
+
+    for (i = 0; i < cachep->num; i++)
+    {
+        void *objp = slabp->s_mem + cachep->objsize * i;
+
+#ifdef CONFIG_DEBUG_SLAB
+        if (cachep->flags & SLAB_RED_ZONE)
+            *dbg_redzone1(objp) = *dbg_redzone2(cachep, objp) = RED_MAGIC1;
+        if (cachep->flags & SLAB_STORE_USER)
+            *dbg_userword(cachep, objp) = NULL;
+        if (cachep->flags & SLAB_POISON)
+            kmem_poison_obj(cachep, objp);
+        objp += dbg_obj_offset(cachep); /* 构造函数看到的是调用者看到的对象 */
+#endif
+        if (cachep->ctor)
+            cachep->ctor(objp, cachep, ctor_flags);
+        slab_bufctl(slabp)[i] = i + 1;
+    }
+    slab_bufctl(slabp)[i - 1] = BUFCTL_END;
+    slabp->free = 0;
+}
+
+/* 销毁一个已经从缓存池链表中摘下的slab，有析构函数就先析构其中每一个对象，
+管理结构在slab外面时把它还给slabp_cache，参数：
+cachep：slab所属的缓存池
+slabp：要销毁的slab */
+static void kmem_slab_destroy(kmem_cache_t *cachep, slab_t *slabp)
+{
+    if (cachep->dtor)
+    {
+        unsigned int i;
+
+        for (i = 0; i < cachep->num; i++)
+        {
+            void *objp = slabp->s_mem + cachep->objsize * i;
+
+#ifdef CONFIG_DEBUG_SLAB
+            objp += dbg_obj_offset(cachep);
+#endif
+            cachep->dtor(objp, cachep, 0);
+        }
+    }
+    kmem_freepages(cachep, slabp->s_mem - slabp->colouroff);
+    if (OFF_SLAB(cachep))
+        kmem_cache_free(cachep->slabp_cache, slabp);
+}
+
+/* 为缓存池增加一个slab：从伙伴系统分配页面，建立slab管理结构，把它挂到缓存池的slab链表尾部，参数：
+cachep：要增长的缓存池
+flags：分配标志
+返回：成功返回1，失败返回0 */
+static int kmem_cache_grow(kmem_cache_t *cachep, int flags)
+{
+    slab_t *slabp;
+    struct page *page;
+    void *objp;
+    size_t offset;
+    unsigned int i;
+    unsigned long ctor_flags;
+    unsigned long save_flags;
+
+    if (flags & ~(SLAB_DMA | SLAB_LEVEL_MASK | SLAB_NO_GROW))
+        BUG();
+    if (flags & SLAB_NO_GROW)
+        return 0;
+
+    spin_lock_irqsave(&cachep->spinlock, save_flags);
+
+    /* 取下一种颜色作为这个slab的着色偏移，颜色依次轮转 */
+    offset = cachep->colour_next;
+    cachep->colour_next++;
+    if (cachep->colour_next >= cachep->colour)
+        cachep->colour_next = 0;
+    offset *= cachep->colour_off;
+    cachep->dflags |= DFLGS_GROWN;
+
+    cachep->growing++; /* 正在增长的缓存池不会被收缩 */
+    spin_unlock_irqrestore(&cachep->spinlock, save_flags);
+
+    if (!(objp = kmem_getpages(cachep, flags & ~SLAB_NO_GROW)))
+        goto failed;
+
+    if (!(slabp = kmem_cache_slabmgmt(cachep, objp, offset, flags & SLAB_LEVEL_MASK)))
+        goto opps1;
+
+    /* 在每个页面中记下它属于哪个缓存池、哪个slab */
+    i = 1 << cachep->gfporder;
+    page = virt_to_page(objp);
+    do
+    {
+        SET_PAGE_CACHE(page, cachep);
+        SET_PAGE_SLAB(page, slabp);
+        PageSetSlab(page);
+        page++;
+    } while (--i);
+
+    /* 不能睡眠的分配请求触发的增长，构造函数也不能睡眠 */
+    ctor_flags = SLAB_CTOR_CONSTRUCTOR;
+    if (!(flags & __GFP_WAIT))
+        ctor_flags |= SLAB_CTOR_ATOMIC;
+    kmem_cache_init_objs(cachep, slabp, ctor_flags);
+
+    spin_lock_irqsave(&cachep->spinlock, save_flags);
+    cachep->growing--;
+
+    /* 全空的slab放在链表尾部，如果之前没有未满的slab，它就是第一个未满的slab */
+    list_add_tail(&slabp->list, &cachep->slabs);
+    if (cachep->firstnotfull == &cachep->slabs)
+        cachep->firstnotfull = &slabp->list;
+    cachep->failures = 0;
+    STATS_INC_GROWN(cachep);
+
+    spin_unlock_irqrestore(&cachep->spinlock, save_flags);
+    return 1;
+
+opps1:
+    kmem_freepages(cachep, objp);
+failed:
+    spin_lock_irqsave(&cachep->spinlock, save_flags);
+    cachep->growing--;
+    cachep->failures++;
+    STATS_INC_ERR(cachep);
+    spin_unlock_irqrestore(&cachep->spinlock, save_flags);
+    return 0;
+}
+
+/* 从一个未满的slab中取出第一个空闲对象，调用者持有缓存池的锁，参数：
+cachep：缓存池
+slabp：缓存池中第一个未满的slab
+返回：对象的地址 */
+static inline void *kmem_cache_alloc_one_tail(kmem_cache_t *cachep, slab_t *slabp)
+{
+    void *objp;
+
+    slabp->inuse++;
+    objp = slabp->s_mem + slabp->free * cachep->objsize;
+    slabp->free = slab_bufctl(slabp)[slabp->free];
+
+    if (slabp->free == BUFCTL_END) /* slab满了，firstnotfull移到下一个slab */
+        cachep->firstnotfull = slabp->list.next;
+    return objp;
+}
+
+/* 对象数组空了，从slab中成批取出batchcount个对象放进数组，再从中取一个返回，参数：
+cachep：缓存池
+cc：当前cpu的对象数组
+返回：对象的地址，slab中没有空闲对象了返回NULL */
+static void *kmem_cache_alloc_batch(kmem_cache_t *cachep, cpucache_t *cc)
+{
+    unsigned int batchcount = cachep->batchcount;
+    struct list_head *entry;
+    slab_t *slabp;
+
+    spin_lock(&cachep->spinlock);
+    while (batchcount--)
+    {
+        entry = cachep->firstnotfull;
+        if (entry == &cachep->slabs) /* 所有slab都满了，取到多少算多少 */
+            break;
+        slabp = list_entry(entry, slab_t, list);
+        cc_entry(cc)[cc->avail++] = kmem_cache_alloc_one_tail(cachep, slabp);
+    }
+    spin_unlock(&cachep->spinlock);
+
+    if (cc->avail)
+        return cc_entry(cc)[--cc->avail];
+    return NULL;
+}
+
+/* 从缓存池中分配一个对象，参数：
+cachep：缓存池
+flags：分配标志，见SLAB_KERNEL、SLAB_ATOMIC等
+返回：对象的地址，失败返回NULL */
+void *kmem_cache_alloc(kmem_cache_t *cachep, int flags)
+{
+    unsigned long save_flags;
+    struct list_head *entry;
+    cpucache_t *cc;
+    slab_t *slabp;
+    void *objp;
+
+    /* 要求DMA内存，缓存池的slab却不是从DMA区域分配的 */
+    if ((flags & SLAB_DMA) && !(cachep->gfpflags & GFP_DMA))
+        BUG();
+
+try_again:
+    local_irq_save(save_flags); /* 对象数组只属于当前cpu，关中断就足以保护它 */
+    cc = cc_data(cachep);
+    if (cc)
+    {
+        if (cc->avail) /* 最快的路径：不用获取锁，也不用访问slab */
+        {
+            STATS_INC_ALLOCHIT(cachep);
+            objp = cc_entry(cc)[--cc->avail];
+        }
+        else
+        {
+            STATS_INC_ALLOCMISS(cachep);
+            objp = kmem_cache_alloc_batch(cachep, cc);
+            if (!objp)
+                goto alloc_new_slab;
+        }
+        goto got_obj;
+    }
+
+    spin_lock(&cachep->spinlock);
+    entry = cachep->firstnotfull;
+    if (entry == &cachep->slabs) /* 所有slab都满了 */
+    {
+        spin_unlock(&cachep->spinlock);
+        goto alloc_new_slab;
+    }
+    slabp = list_entry(entry, slab_t, list);
+    objp = kmem_cache_alloc_one_tail(cachep, slabp);
+    spin_unlock(&cachep->spinlock);
+got_obj:
+    STATS_INC_ALLOCED(cachep);
+    local_irq_restore(save_flags);
+#ifdef CONFIG_DEBUG_SLAB
+    objp = kmem_debug_alloc(cachep, objp, __builtin_return_address(0));
+#endif
+    return objp;
+
+alloc_new_slab:
+    local_irq_restore(save_flags);
+    if (kmem_cache_grow(cachep, flags))
+        /* 新的slab已经挂上去了，重试。在我们解锁期间别人可能已经把它用掉了，所以要从头再来 */
+        goto try_again;
+    return NULL;
+}
+
+/* 把一个对象放回它所在slab的空闲对象链，并调整slab在链表中的位置，调用者持有缓存池的锁。
+缓存池的slab链表按全满、部分使用、全空的顺序排列，firstnotfull指向第一个未满的slab，参数：
+cachep：缓存池
+objp：要释放的对象 */
+static inline void kmem_cache_free_one(kmem_cache_t *cachep, void *objp)
+{
+    slab_t *slabp;
+    unsigned int objnr;
+
+    slabp = GET_PAGE_SLAB(virt_to_page(objp));
+
+    objnr = (objp - slabp->s_mem) / cachep->objsize; /* 对象在slab中的序号 */
+#ifdef CONFIG_DEBUG_SLAB
+    if (cachep->flags & SLAB_DEBUG_FREE) /* 对象已经在空闲对象链上，说明它被释放了两次 */
+    {
+        kmem_bufctl_t i;
+
+        for (i = slabp->free; i != BUFCTL_END; i = slab_bufctl(slabp)[i])
+            if (i == objnr)
+                kmem_debug_error(cachep, objp, "double free detected by bufctl", __builtin_return_address(0));
+    }
+#endif
+    slab_bufctl(slabp)[objnr] = slabp->free;
+    slabp->free = objnr;
+
+    if (slabp->inuse-- == cachep->num) /* 原来是满的 */
+        goto moveslab_partial;
+    if (!slabp->inuse) /* 原来部分使用，现在全空了 */
+        goto moveslab_free;
+    return;
+
+moveslab_partial:
+    /* 原来是满的，挪到全满slab的末尾，成为第一个未满的slab。
+    即使它现在全空也可以这样做，因为这说明缓存池中没有部分使用的slab */
+    {
+        struct list_head *t = cachep->firstnotfull;
+
+        cachep->firstnotfull = &slabp->list;
+        if (slabp->list.next == t) /* 已经在正确的位置上 */
+            return;
+        list_del(&slabp->list);
+        list_add_tail(&slabp->list, t);
+        return;
+    }
+moveslab_free:
+    /* 原来部分使用，现在全空了，挪到链表尾部。firstnotfull可能正指向它 */
+    {
+        struct list_head *t = cachep->firstnotfull->prev;
+
+        list_del(&slabp->list);
+        list_add_tail(&slabp->list, &cachep->slabs);
+        if (cachep->firstnotfull == &slabp->list)
+            cachep->firstnotfull = t->next;
+        return;
+    }
+}
+
+/* 把一批对象还给它们所在的slab，参数：
+cachep：缓存池
+objpp：对象指针数组
+len：对象个数 */
+static void free_block(kmem_cache_t *cachep, void **objpp, int len)
+{
+    spin_lock(&cachep->spinlock);
+    while (len--)
+        kmem_cache_free_one(cachep, *objpp++);
+    spin_unlock(&cachep->spinlock);
+}
+
+/* kmem_cache_free与kfree共用的释放路径，参数：
+cachep：对象所属的缓存池
+objp：要释放的对象
+caller：释放的调用者，调试模式下记录在对象中 */
+static inline void __kmem_cache_free(kmem_cache_t *cachep, void *objp, void *caller)
+{
+    unsigned long flags;
+    cpucache_t *cc;
+
+#ifdef CONFIG_DEBUG_SLAB
+    objp = kmem_debug_free(cachep, objp, caller);
+#else
+    (void)caller;
+#endif
+    local_irq_save(flags);
+    STATS_INC_FREED(cachep);
+    cc = cc_data(cachep);
+    if (cc)
+    {
+        if (cc->avail >= cc->limit) /* 数组满了，把数组末尾的一批还给slab，腾出位置 */
+        {
+            STATS_INC_FREEMISS(cachep);
+            cc->avail -= cachep->batchcount;
+            free_block(cachep, &cc_entry(cc)[cc->avail], cachep->batchcount);
+        }
+        else
+            STATS_INC_FREEHIT(cachep);
+        cc_entry(cc)[cc->avail++] = objp;
+    }
+    else
+        free_block(cachep, &objp, 1);
+    local_irq_restore(flags);
+}
+
+/* 把一个对象还给缓存池，参数：
+cachep：对象所属的缓存池
+objp：要释放的对象 */
+void kmem_cache_free(kmem_cache_t *cachep, void *objp)
+{
+    __kmem_cache_free(cachep, objp, __builtin_return_address(0));
+}
+
+/* 分配一块内核内存，物理地址连续，参数：
+size：要分配的字节数
+flags：分配标志，带GFP_DMA时从DMA区域的缓存池分配
+返回：内存的地址，失败或size太大返回NULL */
+void *kmalloc(size_t size, int flags)
+{
+    cache_sizes_t *csizep;
+
+    if (size > KMALLOC_MAX_SIZE)
+        return NULL;
+    csizep = cache_sizes + kmalloc_index(size);
+#ifdef CONFIG_DEBUG_SLAB
+    {
+        kmem_cache_t *cachep = flags & GFP_DMA ? csizep->cs_dmacachep : csizep->cs_cachep;
+        void *objp = kmem_cache_alloc(cachep, flags);
+
+        /* 记下kmalloc的调用者，而不是kmalloc自己 */
+        if (objp && (cachep->flags & SLAB_STORE_USER))
+            *dbg_userword(cachep, objp - dbg_obj_offset(cachep)) = __builtin_return_address(0);
+        return objp;
+    }
+#else
+    return kmem_cache_alloc(flags & GFP_DMA ? csizep->cs_dmacachep : csizep->cs_cachep, flags);
+#endif
+}
+
+/* 释放kmalloc分配的内存，由地址找到页面，页面中记录了它属于哪个缓存池，参数：
+objp：要释放的内存，可以是NULL */
+void kfree(const void *objp)
+{
+    kmem_cache_t *c;
+
+    if (!objp)
+        return;
+    c = GET_PAGE_CACHE(virt_to_page(objp));
+    __kmem_cache_free(c, (void *)objp, __builtin_return_address(0)); /* 记下kfree的调用者，而不是kfree自己 */
+}
+
+/* 找到能放下size字节的kmalloc缓存池，参数：
+size：对象的大小
+gfpflags：带GFP_DMA时返回DMA区域的缓存池
+返回：缓存池，size太大或者缓存池还没有创建时返回NULL */
+kmem_cache_t *kmem_find_general_cachep(size_t size, int gfpflags)
+{
+    cache_sizes_t *csizep;
+
+    if (size > KMALLOC_MAX_SIZE)
+        return NULL;
+    csizep = cache_sizes + kmalloc_index(size);
+    return (gfpflags & GFP_DMA) ? csizep->cs_dmacachep : csizep->cs_cachep;
+}
+
+/* 把缓存池所有cpu对象数组中的对象都还给slab，收缩或销毁缓存池之前调用，参数：
+cachep：缓存池 */
+static void drain_cpu_caches(kmem_cache_t *cachep)
+{
+    unsigned long flags;
+    cpucache_t *cc;
+    int i;
+
+    local_irq_save(flags);
+    for (i = 0; i < NR_CPUS; i++)
+    {
+        cc = cachep->cpudata[i];
+        if (cc && cc->avail)
+        {
+            free_block(cachep, cc_entry(cc), cc->avail);
+            cc->avail = 0;
+        }
+    }
+    local_irq_restore(flags);
+}
+
+/* 设置缓存池对象数组的大小与每批交换的对象数，为每个cpu换上新的对象数组，
+旧数组中的对象还给slab，参数：
+cachep：缓存池
+limit：对象数组最多能放的对象数，0表示不使用对象数组
+batchcount：每批交换的对象数，不能超过limit的一半
+返回：成功返回0，失败返回错误码 */
+static int kmem_tune_cpucache(kmem_cache_t *cachep, unsigned int limit, unsigned int batchcount)
+{
+    cpucache_t *new[NR_CPUS], *old;
+    unsigned long flags;
+    int i;
+
+    if (!cachep || limit > CPUCACHE_MAX_LIMIT || (limit && !batchcount) || batchcount > limit / 2)
+        return -EINVAL;
+
+    for (i = 0; i < NR_CPUS; i++)
+    {
+        new[i] = NULL;
+        if (!limit)
+            continue;
+        new[i] = kmem_cache_alloc(cpucache_cachep, SLAB_KERNEL);
+        if (!new[i])
+            goto oom;
+        new[i]->avail = 0;
+        new[i]->limit = limit;
+    }
+
+    for (i = 0; i < NR_CPUS; i++)
+    {
+        local_irq_save(flags);
+        old = cachep->cpudata[i];
+        cachep->cpudata[i] = new[i];
+        cachep->batchcount = batchcount;
+        if (old && old->avail)
+            free_block(cachep, cc_entry(old), old->avail);
+        local_irq_restore(flags);
+        if (old)
+            kmem_cache_free(cpucache_cachep, old);
+    }
+    return 0;
+oom:
+    while (i--)
+        kmem_cache_free(cpucache_cachep, new[i]);
+    return -ENOMEM;
+}
+
+/* 按对象大小为缓存池启用对象数组：对象越小，数组越长，数组中的对象总共大约几十KB。
+大于一个页面的对象很少分配，直接走slab，参数：
+cachep：缓存池 */
+static void enable_cpucache(kmem_cache_t *cachep)
+{
+    unsigned int limit;
+    int err;
+
+    if (cachep == cpucache_cachep) /* 对象数组不能从它自己的对象数组中分配 */
+        return;
+#ifdef CONFIG_DEBUG_SLAB
+    if (cachep->flags & SLAB_DEBUG_FREE) /* 每次释放都要到达slab，才能在空闲对象链上检查重复释放 */
+        return;
+#endif
+    if (cachep->objsize > PAGE_SIZE)
+        return;
+    if (cachep->objsize > 1024)
+        limit = 60;
+    else if (cachep->objsize > 256)
+        limit = 124;
+    else
+        limit = CPUCACHE_MAX_LIMIT;
+
+    err = kmem_tune_cpucache(cachep, limit, limit / 2);
+    if (err)
+        printk("enable_cpucache failed for %s, error %d.\n", cachep->name, -err);
+}
+
+/* 为cpucache_cachep启用之前就已经创建的所有缓存池启用对象数组 */
+static void enable_all_cpucaches(void)
+{
+    struct list_head *p;
+
+    down(&cache_chain_sem);
+    p = &cache_cache.next;
+    do
+    {
+        kmem_cache_t *cachep = list_entry(p, kmem_cache_t, next);
+
+        enable_cpucache(cachep);
+        p = cachep->next.next;
+    } while (p != &cache_cache.next);
+    up(&cache_chain_sem);
+}
+
+/* 创建管理对象数组的缓存池，并为所有已有的缓存池启用对象数组，在kmem_cache_init之后调用。
+Linux2.4中对象数组只在SMP下使用，用于避开缓存池的锁，我们是单cpu，但它同样省去了每次分配释放时对slab链表的遍历与修改，
+而且后进先出地重用刚释放的对象，对象还在cpu缓存中 */
+void __init kmem_cpucache_init(void)
+{
+    cpucache_cachep = kmem_cache_create("cpucache", sizeof(cpucache_t) + CPUCACHE_MAX_LIMIT * sizeof(void *),
+                                        0, SLAB_HWCACHE_ALIGN | SLAB_NO_REAP, NULL, NULL);
+    if (!cpucache_cachep)
+        BUG();
+    g_cpucache_up = 1;
+    enable_all_cpucaches();
+}
+
+/* 释放缓存池尾部所有全空的slab，参数：
+cachep：要收缩的缓存池
+返回：缓存池中还有slab返回1，否则返回0 */
+static int __kmem_cache_shrink(kmem_cache_t *cachep)
+{
+    slab_t *slabp;
+    unsigned long flags;
+    int ret;
+
+    drain_cpu_caches(cachep); /* 对象数组中的对象也是空闲的，先还给slab */
+
+    spin_lock_irqsave(&cachep->spinlock, flags);
+    while (!cachep->growing) /* 正在增长的缓存池会往链表尾部挂新的slab，不去收缩它 */
+    {
+        struct list_head *p;
+
+        p = cachep->slabs.prev;
+        if (p == &cachep->slabs) /* 没有slab了 */
+            break;
+
+        slabp = list_entry(p, slab_t, list);
+        if (slabp->inuse) /* 全空的slab都在尾部，遇到一个在用的就可以停了 */
+            break;
+
+        list_del(&slabp->list);
+        if (cachep->firstnotfull == &slabp->list)
+            cachep->firstnotfull = &cachep->slabs;
+
+        spin_unlock_irqrestore(&cachep->spinlock, flags);
+        kmem_slab_destroy(cachep, slabp);
+        spin_lock_irqsave(&cachep->spinlock, flags);
+    }
+    ret = !list_empty(&cachep->slabs);
+    spin_unlock_irqrestore(&cachep->spinlock, flags);
+    return ret;
+}
+
+/* 收缩缓存池，把全空的slab还给伙伴系统，参数：
+cachep：要收缩的缓存池
+返回：缓存池中还有slab返回1，否则返回0 */
+int kmem_cache_shrink(kmem_cache_t *cachep)
+{
+    if (!cachep || cachep == &cache_cache)
+        BUG();
+    return __kmem_cache_shrink(cachep);
+}
+
+/* 销毁一个缓存池，调用者必须保证缓存池中所有对象都已经释放，参数：
+cachep：要销毁的缓存池
+返回：成功返回0，缓存池中还有对象在使用返回1 */
+int kmem_cache_destroy(kmem_cache_t *cachep)
+{
+    if (!cachep || cachep->growing)
+        BUG();
+
+    /* 先从全局缓存池链表上摘下来，链表中至少还有cache_cache，它永远不会被销毁 */
+    down(&cache_chain_sem);
+    if (clock_searchp == cachep)
+        clock_searchp = list_entry(cachep->next.next, kmem_cache_t, next);
+    list_del(&cachep->next);
+    up(&cache_chain_sem);
+
+    if (__kmem_cache_shrink(cachep)) /* 还有对象没有释放，放回链表 */
+    {
+        printk("kmem_cache_destroy: Can't free all objects %p\n", cachep);
+        down(&cache_chain_sem);
+        list_add(&cachep->next, &cache_chain);
+        up(&cache_chain_sem);
+        return 1;
+    }
+    {
+        int i;
+
+        for (i = 0; i < NR_CPUS; i++) /* 对象数组已经在收缩时清空了 */
+            if (cachep->cpudata[i])
+                kmem_cache_free(cpucache_cachep, cachep->cpudata[i]);
+    }
+    kmem_cache_free(&cache_cache, cachep);
+    return 0;
+}
+
+/* 在内存紧张时回收slab缓存池中全空的slab。从clock_searchp开始最多扫描REAP_SCANLEN个缓存池，
+跳过标记了SLAB_NO_REAP的、正在增长的以及上次回收以来增长过的缓存池（它们很可能马上又要用到这些slab），
+选出全空slab占用页面最多的一个，回收它80%的全空slab，剩下的留给接下来的分配。
+有构造函数的缓存池重建slab代价更高，高阶slab的页面还回去之后很难再凑齐，计算页面数时都打个折扣。
+Linux2.4中它还有一个gfp_mask参数，用来决定能不能睡眠等待cache_chain_sem，我们总是不等待，返回：
+还给伙伴系统的页面数 */
+int kmem_cache_reap(void)
+{
+    slab_t *slabp;
+    kmem_cache_t *searchp;
+    kmem_cache_t *best_cachep;
+    unsigned int best_pages;
+    unsigned int best_len;
+    unsigned int scan;
+    unsigned long flags;
+    int ret = 0;
+
+    /* 我们不能睡眠等待信号量。持有它的是正在创建、销毁或调整缓存池的代码，
+    它们分配页面时触发的回收不能去动缓存池链表 */
+    if (down_trylock(&cache_chain_sem))
+        return 0;
+
+    scan = REAP_SCANLEN;
+    best_len = 0;
+    best_pages = 0;
+    best_cachep = NULL;
+    searchp = clock_searchp;
+    do
+    {
+        unsigned int pages;
+        struct list_head *p;
+        unsigned int full_free;
+
+        if (searchp->flags & SLAB_NO_REAP) /* 不允许回收的缓存池 */
+            goto next;
+        spin_lock_irqsave(&searchp->spinlock, flags);
+        if (searchp->growing) /* 正在增长，新的slab马上就要用 */
+            goto next_unlock;
+        if (searchp->dflags & DFLGS_GROWN) /* 最近增长过，这一轮放过它，下一轮再看 */
+        {
+            searchp->dflags &= ~DFLGS_GROWN;
+            goto next_unlock;
+        }
+        spin_unlock_irqrestore(&searchp->spinlock, flags);
+        drain_cpu_caches(searchp); /* 对象数组中的对象也是空闲的，还给slab才能让slab变空 */
+        spin_lock_irqsave(&searchp->spinlock, flags);
+
+        /* 全空的slab都在链表尾部，从后往前数 */
+        full_free = 0;
+        p = searchp->slabs.prev;
+        while (p != &searchp->slabs)
+        {
+            slabp = list_entry(p, slab_t, list);
+            if (slabp->inuse)
+                break;
+            full_free++;
+            p = p->prev;
+        }
+
+        pages = full_free * (1 << searchp->gfporder);
+        if (searchp->ctor)
+            pages = (pages * 4 + 1) / 5;
+        if (searchp->gfporder)
+            pages = (pages * 4 + 1) / 5;
+        if (pages > best_pages)
+        {
+            best_cachep = searchp;
+            best_len = full_free;
+            best_pages = pages;
+            if (full_free >= REAP_PERFECT) /* 足够多了，不用再找 */
+            {
+                clock_searchp = list_entry(searchp->next.next, kmem_cache_t, next);
+                goto perfect;
+            }
+        }
+    next_unlock:
+        spin_unlock_irqrestore(&searchp->spinlock, flags);
+    next:
+        searchp = list_entry(searchp->next.next, kmem_cache_t, next);
+    } while (--scan && searchp != clock_searchp);
+
+    clock_searchp = searchp;
+
+    if (!best_cachep) /* 没有可以回收的 */
+        goto out;
+
+    spin_lock_irqsave(&best_cachep->spinlock, flags);
+perfect:
+    best_len = (best_len * 4 + 1) / 5; /* 只回收80%的全空slab */
+    for (scan = 0; scan < best_len; scan++)
+    {
+        struct list_head *p;
+
+        if (best_cachep->growing)
+            break;
+        p = best_cachep->slabs.prev;
+        if (p == &best_cachep->slabs)
+            break;
+        slabp = list_entry(p, slab_t, list);
+        if (slabp->inuse)
+            break;
+        list_del(&slabp->list);
+        if (best_cachep->firstnotfull == &slabp->list)
+            best_cachep->firstnotfull = &best_cachep->slabs;
+        STATS_INC_REAPED(best_cachep);
+
+        /* slab已经不在缓存池的链表上了，可以放开锁再释放页面 */
+        spin_unlock_irqrestore(&best_cachep->spinlock, flags);
+        kmem_slab_destroy(best_cachep, slabp);
+        spin_lock_irqsave(&best_cachep->spinlock, flags);
+    }
+    spin_unlock_irqrestore(&best_cachep->spinlock, flags);
+    ret = scan * (1 << best_cachep->gfporder);
+out:
+    up(&cache_chain_sem);
+    return ret;
+}
+
+/* 遍历全局缓存池链表，为每个缓存池打印一行统计（相当于/proc/slabinfo）：
+调用者手中的对象数与slab中的对象总数、对象大小、在用与全部slab数、每个slab的页面数、
+分配与释放次数、调用者手中对象数的最大值、增长与被回收的slab数、增长失败次数，
+以及每个cpu对象数组的命中与未命中次数。最后打印slab一共占用了多少页面，用于找出哪个缓存池占用的内存最多 */
+void show_slabinfo(void)
+{
+    struct list_head *p;
+    unsigned long total_pages = 0;
+    unsigned long flags;
+
+    printk("slabinfo: name             active   objs size aslabs slabs pages   allocs    frees   high grown reaped err"
+           "   ahit  amiss   fhit  fmiss\n");
+    down(&cache_chain_sem);
+    p = &cache_cache.next;
+    do
+    {
+        kmem_cache_t *cachep = list_entry(p, kmem_cache_t, next);
+        unsigned long active_slabs = 0, num_slabs = 0;
+        struct list_head *q;
+
+        spin_lock_irqsave(&cachep->spinlock, flags);
+        for (q = cachep->slabs.next; q != &cachep->slabs; q = q->next)
+        {
+            slab_t *slabp = list_entry(q, slab_t, list);
+
+            num_slabs++;
+            if (slabp->inuse)
+                active_slabs++;
+        }
+        printk("slabinfo: %-16s %6lu %6lu %4u %6lu %5lu %5u %8lu %8lu %6lu %5lu %6lu %3lu %6lu %6lu %6lu %6lu\n",
+               cachep->name, cachep->num_active, num_slabs * cachep->num, cachep->objsize,
+               active_slabs, num_slabs, 1 << cachep->gfporder,
+               cachep->num_allocations, cachep->num_frees, cachep->high_mark,
+               cachep->grown, cachep->reaped, cachep->errors,
+               cachep->allochit, cachep->allocmiss, cachep->freehit, cachep->freemiss);
+        spin_unlock_irqrestore(&cachep->spinlock, flags);
+        total_pages += num_slabs << cachep->gfporder;
+        p = cachep->next.next;
+    } while (p != &cache_cache.next);
+    up(&cache_chain_sem);
+    printk("slabinfo: %lu pages (%lu KB) in slabs\n", total_pages, total_pages << (PAGE_SHIFT - 10));
+}
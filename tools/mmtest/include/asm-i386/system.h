@@ -0,0 +1,27 @@
+#ifndef _MMTEST_ASM_I386_SYSTEM_H
+#define _MMTEST_ASM_I386_SYSTEM_H
+/* 宿主机上的内存分配器测试（见tools/mmtest/mmtest.c）用的asm-i386/system.h。
+它在-I中排在./include前面，先包含内核原来的system.h，再把开关中断换掉：
+cli与sti是特权指令，在用户态执行会触发一般保护异常。测试程序只有一个线程，也没有中断，
+单核内核的自旋锁本来就是空操作，spin_lock_irqsave只剩下开关中断，这里把它们都换成空操作 */
+
+#include_next <asm-i386/system.h>
+
+#undef __cli
+#undef __sti
+#undef local_irq_save
+#undef __restore_flags
+
+/* 关中断，用户态下什么都不做 */
+#define __cli() __asm__ __volatile__("" : : : "memory")
+
+/* 开中断，用户态下什么都不做 */
+#define __sti() __asm__ __volatile__("" : : : "memory")
+
+/* 只保存eflags，不关中断 */
+#define local_irq_save(x) __asm__ __volatile__("pushfl ; popl %0" : "=g"(x) : : "memory")
+
+/* 恢复eflags，用户态下popfl不会改变中断标志，保留原来的写法 */
+#define __restore_flags(x) __asm__ __volatile__("pushl %0 ; popfl" : : "g"(x) : "memory")
+
+#endif /* _MMTEST_ASM_I386_SYSTEM_H */
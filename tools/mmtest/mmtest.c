@@ -0,0 +1,166 @@
+/* 在宿主机上运行内存分配器的压力测试与基准（make mmtest），不需要启动qemu。
+mm/下的伙伴系统、引导内存分配器与slab分配器原样编译成一个32位的用户态程序，
+mm_bench.c中的随机分配/释放序列与start_kernel中CONFIG_MM_BENCH打开时跑的完全相同。
+这个文件就是它们下面的一层垫片：
+1. 物理内存：用mmap在PAGE_OFFSET（3GB）处映射一段匿名内存，__pa/__va照常工作，
+   __get_free_pages分配出去的就是这段内存中的页面。需要64位的宿主机内核，
+   32位进程在64位内核下可以使用完整的4GB地址空间，3GB以上的地址才空着
+2. 自旋锁与开关中断：见tools/mmtest/include/asm-i386/system.h
+3. 位操作：asm-i386/bitops.h中的指令在用户态都能执行，直接使用内核的实现
+4. printk：用内核的vsprintf格式化后write到标准输出
+5. 时间戳计数器：rdtsc在用户态可以执行，cpu_khz用nanosleep前后的时间戳差算出
+程序不链接c库，直接用int $0x80发起系统调用，因此不需要宿主机装32位的c库 */
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/bootmem.h>
+#include <linux/slab.h>
+#include <linux/swap.h>
+#include <linux/swapctl.h>
+#include <linux/mm_bench.h>
+#include <asm-i386/e820.h>
+
+/* 模拟的物理内存页面数，512MB */
+#define MMTEST_PAGES 131072UL
+
+/* 模拟的ZONE_DMA页面数，16MB */
+#define MMTEST_DMA_PAGES 4096UL
+
+/* 模拟的内核映像从1MB开始，占用的页面数，引导内存分配器的位图紧跟其后 */
+#define MMTEST_KERNEL_PAGES 256UL
+
+/* 用到的i386系统调用号 */
+#define __NR_exit 1
+#define __NR_write 4
+#define __NR_nanosleep 162
+#define __NR_mmap2 192
+
+/* mmap的参数 */
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define MAP_PRIVATE 0x02
+#define MAP_FIXED 0x10
+#define MAP_ANONYMOUS 0x20
+#define MAP_NORESERVE 0x4000
+
+/* 内核中由其他文件（arch/i386/mm/init.c、arch/i386/kernel/time.c等）定义、测试程序没有编译进来的变量 */
+mem_map_t *mem_map;
+unsigned long max_mapnr;
+unsigned long num_physpages;
+int memory_pressure;
+freepages_t freepages;
+unsigned long cpu_khz;
+struct cpuinfo_x86 boot_cpu_data;
+
+/* 发起一次系统调用，最多6个参数，第6个参数放在ebp中 */
+static long mmtest_syscall(long nr, long a, long b, long c, long d, long e, long f)
+{
+    long ret;
+
+    __asm__ __volatile__("push %%ebp\n\t"
+                         "mov %7, %%ebp\n\t"
+                         "int $0x80\n\t"
+                         "pop %%ebp"
+                         : "=a"(ret)
+                         : "a"(nr), "b"(a), "c"(b), "d"(c), "S"(d), "D"(e), "g"(f)
+                         : "memory");
+    return ret;
+}
+
+static void mmtest_exit(int code)
+{
+    mmtest_syscall(__NR_exit, code, 0, 0, 0, 0, 0);
+}
+
+/* 格式化后写到标准输出，去掉行首的日志等级（如<4>） */
+asmlinkage int printk(const char *fmt, ...)
+{
+    static char buf[1024];
+    char *p = buf;
+    va_list args;
+    int n;
+
+    va_start(args, fmt);
+    n = vsprintf(buf, fmt, args);
+    va_end(args);
+    if (n >= 3 && p[0] == '<' && p[1] >= '0' && p[1] <= '7' && p[2] == '>')
+    {
+        p += 3;
+        n -= 3;
+    }
+    mmtest_syscall(__NR_write, 1, (long)p, n, 0, 0, 0);
+    return n;
+}
+
+/* 用睡眠100ms前后的时间戳差估计cpu主频 */
+static unsigned long mmtest_calibrate_tsc(void)
+{
+    long ts[2] = {0, 100000000}; /* struct timespec：0秒，1亿纳秒 */
+    cycles_t start, end;
+
+    start = get_cycles();
+    mmtest_syscall(__NR_nanosleep, (long)ts, 0, 0, 0, 0, 0);
+    end = get_cycles();
+    return (unsigned long)((end - start) / 100);
+}
+
+/* identify_cpu中内存管理要用到的部分：cpuid 1号功能中的能力位与CLFLUSH缓存行大小 */
+static void mmtest_identify_cpu(struct cpuinfo_x86 *c)
+{
+    int junk, misc, capability;
+
+    c->x86_cache_alignment = L1_CACHE_BYTES;
+    cpuid(0x00000001, &junk, &misc, &junk, &capability);
+    c->x86_capability[0] = capability;
+    if (cpu_has(c, X86_FEATURE_CLFLSH) && ((misc >> 8) & 0xff))
+        c->x86_cache_alignment = ((misc >> 8) & 0xff) * 8;
+}
+
+/* 模拟setup_arch、paging_init与mem_init中与内存管理有关的部分，然后运行基准测试 */
+void _start(void)
+{
+    unsigned long zones_size[MAX_NR_ZONES] = {MMTEST_DMA_PAGES, MMTEST_PAGES - MMTEST_DMA_PAGES, 0};
+    unsigned long start_pfn = (HIGH_MEMORY >> PAGE_SHIFT) + MMTEST_KERNEL_PAGES; /* 内核映像之后的第一个页面 */
+    unsigned long bootmap_size;
+    long ret;
+
+    ret = mmtest_syscall(__NR_mmap2, PAGE_OFFSET, MMTEST_PAGES << PAGE_SHIFT, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ret != (long)PAGE_OFFSET)
+    {
+        printk("mmtest: can't map %luMB at %08lx (%ld), a 64-bit host kernel is required\n",
+               MMTEST_PAGES >> (20 - PAGE_SHIFT), PAGE_OFFSET, ret);
+        mmtest_exit(1);
+    }
+    cpu_khz = mmtest_calibrate_tsc();
+    mmtest_identify_cpu(&boot_cpu_data);
+
+    /* setup_arch：整段内存都是可用的RAM，保留0页、内核映像与引导内存位图 */
+    bootmap_size = init_bootmem(start_pfn, MMTEST_PAGES);
+#ifdef CONFIG_NO_BOOTMEM
+    memblock_add(0, MMTEST_PAGES << PAGE_SHIFT);
+#else
+    free_bootmem(0, MMTEST_PAGES << PAGE_SHIFT);
+#endif
+    reserve_bootmem(HIGH_MEMORY, (start_pfn << PAGE_SHIFT) + bootmap_size + PAGE_SIZE - 1 - HIGH_MEMORY);
+    reserve_bootmem(0, PAGE_SIZE);
+
+    /* paging_init，整段内存在开头已经映射好了 */
+#ifdef CONFIG_NO_BOOTMEM
+    memblock_set_current_limit(MMTEST_PAGES << PAGE_SHIFT);
+#endif
+    free_area_init(zones_size);
+
+    /* start_kernel中的顺序 */
+    kmem_cache_init();
+    max_mapnr = num_physpages = MMTEST_PAGES;
+    printk("mmtest: %lu pages, %lu freed to the buddy allocator\n", MMTEST_PAGES, free_all_bootmem());
+    kmem_cache_sizes_init();
+    kmem_cpucache_init();
+#ifdef CONFIG_DEFERRED_STRUCT_PAGE_INIT
+    page_alloc_init_late();
+#endif
+    mm_bench();
+    mmtest_exit(0);
+}